@@ -0,0 +1,18 @@
+# Request parser microbenchmark: qmake bench/bench.pro && make && ./parserbench
+QT = core
+
+CONFIG += c++17 cmdline release
+
+TARGET = parserbench
+
+INCLUDEPATH += \
+        ../src/http
+
+SOURCES += \
+        parserbench.cpp \
+        ../src/http/httprequest.cpp \
+        ../src/http/httprequestparser.cpp
+
+HEADERS += \
+    ../src/http/httprequest.h \
+    ../src/http/httprequestparser.h
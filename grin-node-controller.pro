@@ -2,6 +2,9 @@ QT = core network
 
 CONFIG += c++17 cmdline
 
+# gzip/deflate response compression
+LIBS += -lz
+
 # You can make your code fail to compile if it uses deprecated APIs.
 # In order to do so, uncomment the following line.
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
@@ -13,10 +16,33 @@ INCLUDEPATH += \
 
 SOURCES += \
         main.cpp \
+        src/http/httpbodystream.cpp \
+        src/http/httpcompressor.cpp \
+        src/http/httpconnection.cpp \
+        src/http/httpmetrics.cpp \
+        src/http/httprequest.cpp \
+        src/http/httprequestparser.cpp \
+        src/http/httpresponse.cpp \
+        src/http/httprouter.cpp \
         src/http/httpserver.cpp \
+        src/http/httpworker.cpp \
+        src/http/jsonwriter.cpp \
+        src/http/linematcher.cpp \
+        src/http/logstreamhub.cpp \
+        src/http/longpoll.cpp \
+        src/http/proxyrelay.cpp \
+        src/http/upstreampool.cpp \
+        src/nodes/chainpoller.cpp \
         src/nodes/grinppnode.cpp \
         src/nodes/grinrustnode.cpp \
-        src/nodes/nodeproc.cpp
+        src/nodes/lineframer.cpp \
+        src/nodes/logbuffer.cpp \
+        src/nodes/logclassifier.cpp \
+        src/nodes/logmirror.cpp \
+        src/nodes/logparser.cpp \
+        src/nodes/logspool.cpp \
+        src/nodes/nodeproc.cpp \
+        src/nodes/procsampler.cpp
 
 # Default rules for deployment.
 qnx: target.path = /tmp/$${TARGET}/bin
@@ -24,8 +50,32 @@ else: unix:!android: target.path = /opt/$${TARGET}/bin
 !isEmpty(target.path): INSTALLS += target
 
 HEADERS += \
+    src/http/httpbodystream.h \
+    src/http/httpcompressor.h \
+    src/http/httpconnection.h \
+    src/http/httpmetrics.h \
+    src/http/httprequest.h \
+    src/http/httprequestparser.h \
+    src/http/httpresponse.h \
+    src/http/httprouter.h \
     src/http/httpserver.h \
+    src/http/httpworker.h \
+    src/http/jsonwriter.h \
+    src/http/linematcher.h \
+    src/http/logstreamhub.h \
+    src/http/longpoll.h \
+    src/http/proxyrelay.h \
+    src/http/upstreampool.h \
+    src/nodes/chainpoller.h \
     src/nodes/grinppnode.h \
     src/nodes/grinrustnode.h \
     src/nodes/inodecontroller.h \
-    src/nodes/nodeproc.h
+    src/nodes/lineframer.h \
+    src/nodes/logbuffer.h \
+    src/nodes/logclassifier.h \
+    src/nodes/logmirror.h \
+    src/nodes/logparser.h \
+    src/nodes/logspool.h \
+    src/nodes/nodeproc.h \
+    src/nodes/procsampler.h \
+    src/nodes/spscqueue.h
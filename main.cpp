@@ -1,6 +1,7 @@
 #include <QCoreApplication>
 #include <QCommandLineParser>
 #include <QCommandLineOption>
+#include <QThread>
 
 #include "httpserver.h"
 #include "grinrustnode.h"
@@ -54,11 +55,52 @@ int main(int argc, char *argv[])
         "list",
         qEnvironmentVariable("GRINPP_ARGS")
         );
+    QCommandLineOption optLogBytes(
+        "log-bytes",
+        "Log buffer per node in bytes, K/M/G suffix allowed (default 16M)",
+        "size",
+        qEnvironmentVariable("LOG_BYTES", "16M")
+        );
+    QCommandLineOption optLogBytesRust(
+        "log-bytes-rust",
+        "Log buffer of the Grin node, overrides --log-bytes",
+        "size",
+        qEnvironmentVariable("LOG_BYTES_RUST")
+        );
+    QCommandLineOption optLogBytesGrinpp(
+        "log-bytes-grinpp",
+        "Log buffer of the Grin++ node, overrides --log-bytes",
+        "size",
+        qEnvironmentVariable("LOG_BYTES_GRINPP")
+        );
+    QCommandLineOption optLogTotal(
+        "log-total-bytes",
+        "Limit for all log buffers together, also for changes via the API (default 0 = none)",
+        "size",
+        qEnvironmentVariable("LOG_TOTAL_BYTES", "0")
+        );
     QCommandLineOption optLogCap(
         "log-cap",
-        "Logpuffer (default 5000)",
-        "n",
-        "5000"
+        "Deprecated, use --log-bytes: log buffer in lines (~256 bytes each)",
+        "n"
+        );
+    QCommandLineOption optLogMode(
+        "log-mode",
+        "Node output: tee (capture + mirror to stdout), capture, forward (default tee)",
+        "mode",
+        qEnvironmentVariable("LOG_MODE", "tee")
+        );
+    QCommandLineOption optLogNotifyMs(
+        "log-notify-ms",
+        "Min. interval in ms between log update notifications per node (default 100)",
+        "ms",
+        qEnvironmentVariable("LOG_NOTIFY_MS", "100")
+        );
+    QCommandLineOption optLogSpool(
+        "log-spool",
+        "Disk log history per node in <datadir>/controller-logs, K/M/G suffix allowed (default 0 = off)",
+        "size",
+        qEnvironmentVariable("LOG_SPOOL", "0")
         );
     const QString defaultNodePort = qEnvironmentVariable("GRIN_NODE_PORT", "3413");
     QCommandLineOption optNodePort(
@@ -67,14 +109,92 @@ int main(int argc, char *argv[])
         "port",
         defaultNodePort
         );
+    QCommandLineOption optChainPollMs(
+        "chain-poll-ms",
+        "Interval in ms for sampling tip, sync state and peers of the running node (default 5000, 0 = off)",
+        "ms",
+        qEnvironmentVariable("CHAIN_POLL_MS", "5000")
+        );
+    QCommandLineOption optProcSampleMs(
+        "proc-sample-ms",
+        "Interval in ms for CPU/memory/I/O samples of the running node from /proc (default 5000, 0 = off)",
+        "ms",
+        qEnvironmentVariable("PROC_SAMPLE_MS", "5000")
+        );
+    QCommandLineOption optProcHistory(
+        "proc-history",
+        "Resource samples kept per node for /metrics/{id} (default 720)",
+        "n",
+        qEnvironmentVariable("PROC_HISTORY", "720")
+        );
+
+    QCommandLineOption optWorkers(
+        "http-workers",
+        "HTTP worker threads (default 0 = one per CPU core)",
+        "n",
+        qEnvironmentVariable("HTTP_WORKERS", "0")
+        );
+    QCommandLineOption optUpstreamMax(
+        "upstream-max",
+        "Max. concurrent proxied calls per node (default 8)",
+        "n",
+        qEnvironmentVariable("UPSTREAM_MAX", "8")
+        );
+    QCommandLineOption optUpstreamQueue(
+        "upstream-queue",
+        "Max. proxied calls waiting per node before 503 (default 64)",
+        "n",
+        qEnvironmentVariable("UPSTREAM_QUEUE", "64")
+        );
+    QCommandLineOption optUpstreamQueueMs(
+        "upstream-queue-ms",
+        "Max. wait in the upstream queue in ms before 503 (default 5000)",
+        "ms",
+        qEnvironmentVariable("UPSTREAM_QUEUE_MS", "5000")
+        );
+    QCommandLineOption optCompressMin(
+        "compress-min",
+        "Min. response size in bytes for gzip/deflate (default 1024, -1 = off)",
+        "bytes",
+        qEnvironmentVariable("COMPRESS_MIN", "1024")
+        );
+    QCommandLineOption optCompressLevel(
+        "compress-level",
+        "zlib compression level 1..9 (default 6)",
+        "n",
+        qEnvironmentVariable("COMPRESS_LEVEL", "6")
+        );
+    QCommandLineOption optCompressProxy(
+        "compress-proxy",
+        "Compress proxied /v2 replies while streaming, 0 or 1 (default 0)",
+        "0|1",
+        qEnvironmentVariable("COMPRESS_PROXY", "0")
+        );
 
     p.addOption(optPort);
     p.addOption(optRustBin);
     p.addOption(optRustArg);
     p.addOption(optGppBin);
     p.addOption(optGppArg);
+    p.addOption(optLogBytes);
+    p.addOption(optLogBytesRust);
+    p.addOption(optLogBytesGrinpp);
+    p.addOption(optLogTotal);
     p.addOption(optLogCap);
+    p.addOption(optLogMode);
+    p.addOption(optLogNotifyMs);
+    p.addOption(optLogSpool);
     p.addOption(optNodePort);
+    p.addOption(optChainPollMs);
+    p.addOption(optProcSampleMs);
+    p.addOption(optProcHistory);
+    p.addOption(optWorkers);
+    p.addOption(optUpstreamMax);
+    p.addOption(optUpstreamQueue);
+    p.addOption(optUpstreamQueueMs);
+    p.addOption(optCompressMin);
+    p.addOption(optCompressLevel);
+    p.addOption(optCompressProxy);
     p.process(app);
 
     // -------------------------------------------------------------------------------------------------------
@@ -84,14 +204,81 @@ int main(int argc, char *argv[])
     const int portVal = p.value(optPort).toInt(&okPort);
     const quint16 port = (okPort && portVal > 0 && portVal <= 65535) ? quint16(portVal) : quint16(8080);
 
-    bool okCap = false;
-    const int capVal = p.value(optLogCap).toInt(&okCap);
-    const int logCap = (okCap && capVal > 0) ? capVal : 5000;
+    bool okLogBytes = false;
+    const qint64 logBytesVal = LogBuffer::parseByteSize(p.value(optLogBytes), &okLogBytes);
+    qint64 logBytes = (okLogBytes && logBytesVal > 0) ? logBytesVal : NodeProc::kDefaultLogCapacityBytes;
+    if (p.isSet(optLogCap) && !p.isSet(optLogBytes)) {
+        bool okCap = false;
+        const int capVal = p.value(optLogCap).toInt(&okCap);
+        if (okCap && capVal > 0) {
+            logBytes = qint64(capVal) * 256;
+        }
+    }
+    logBytes = qBound(LogBuffer::kMinCapacity, logBytes, LogBuffer::kMaxCapacity);
+    auto nodeLogBytes = [&p, logBytes](const QCommandLineOption &opt) {
+        bool ok = false;
+        const qint64 v = LogBuffer::parseByteSize(p.value(opt), &ok);
+        return (ok && v > 0) ? qBound(LogBuffer::kMinCapacity, v, LogBuffer::kMaxCapacity) : logBytes;
+    };
+    qint64 rustLogBytes = nodeLogBytes(optLogBytesRust);
+    qint64 grinppLogBytes = nodeLogBytes(optLogBytesGrinpp);
+    bool okLogTotal = false;
+    const qint64 logTotalVal = LogBuffer::parseByteSize(p.value(optLogTotal), &okLogTotal);
+    const qint64 logTotal = (okLogTotal && logTotalVal > 0) ? logTotalVal : 0;
+    if (logTotal > 0 && rustLogBytes + grinppLogBytes > logTotal) {
+        // Scale both down to the total, keeping their ratio
+        const qint64 sum = rustLogBytes + grinppLogBytes;
+        rustLogBytes = qMax(LogBuffer::kMinCapacity, rustLogBytes * logTotal / sum);
+        grinppLogBytes = qMax(LogBuffer::kMinCapacity, grinppLogBytes * logTotal / sum);
+    }
+    NodeProc::LogMode logMode = NodeProc::LogMode::Tee;
+    QString logModeName = p.value(optLogMode).trimmed().toLower();
+    if (!NodeProc::parseLogMode(logModeName, &logMode)) {
+        qWarning().noquote() << QString("[!] Unknown log mode '%1', using tee").arg(logModeName);
+        logModeName = "tee";
+    }
+    bool okLogNotify = false;
+    const int logNotifyVal = p.value(optLogNotifyMs).toInt(&okLogNotify);
+    const int logNotifyMs = (okLogNotify && logNotifyVal > 0) ? logNotifyVal : NodeProc::kDefaultLogNotifyMs;
+    bool okLogSpool = false;
+    const qint64 logSpoolVal = LogBuffer::parseByteSize(p.value(optLogSpool), &okLogSpool);
+    const qint64 logSpool = (okLogSpool && logSpoolVal > 0) ? logSpoolVal : 0;
     bool okNodeProxyPort = false;
     const int nodePortVal = p.value(optNodePort).toInt(&okNodeProxyPort);
     const quint16 nodeProxyPort = (okNodeProxyPort && nodePortVal > 0 && nodePortVal <= 65535)
         ? quint16(nodePortVal)
         : quint16(3413);
+    bool okChainPoll = false;
+    const int chainPollVal = p.value(optChainPollMs).toInt(&okChainPoll);
+    const int chainPollMs = (okChainPoll && chainPollVal >= 0) ? chainPollVal : NodeProc::kDefaultChainPollMs;
+    bool okProcSample = false;
+    const int procSampleVal = p.value(optProcSampleMs).toInt(&okProcSample);
+    const int procSampleMs = (okProcSample && procSampleVal >= 0) ? procSampleVal : NodeProc::kDefaultProcSampleMs;
+    bool okProcHistory = false;
+    const int procHistoryVal = p.value(optProcHistory).toInt(&okProcHistory);
+    const int procHistory = (okProcHistory && procHistoryVal > 1) ? procHistoryVal : ProcSampler::kDefaultCapacity;
+
+    bool okWorkers = false;
+    const int workersVal = p.value(optWorkers).toInt(&okWorkers);
+    const int httpWorkers = (okWorkers && workersVal > 0) ? workersVal : 0;
+
+    bool okUpMax = false;
+    const int upMaxVal = p.value(optUpstreamMax).toInt(&okUpMax);
+    const int upstreamMax = (okUpMax && upMaxVal > 0) ? upMaxVal : 8;
+    bool okUpQueue = false;
+    const int upQueueVal = p.value(optUpstreamQueue).toInt(&okUpQueue);
+    const int upstreamQueue = (okUpQueue && upQueueVal >= 0) ? upQueueVal : 64;
+    bool okUpQueueMs = false;
+    const int upQueueMsVal = p.value(optUpstreamQueueMs).toInt(&okUpQueueMs);
+    const int upstreamQueueMs = (okUpQueueMs && upQueueMsVal > 0) ? upQueueMsVal : 5000;
+
+    bool okCompMin = false;
+    const int compMinVal = p.value(optCompressMin).toInt(&okCompMin);
+    const int compressMin = okCompMin ? compMinVal : 1024;
+    bool okCompLevel = false;
+    const int compLevelVal = p.value(optCompressLevel).toInt(&okCompLevel);
+    const int compressLevel = (okCompLevel && compLevelVal >= 1 && compLevelVal <= 9) ? compLevelVal : 6;
+    const bool compressProxy = p.value(optCompressProxy) == "1";
 
     const QString rustBin = p.value(optRustBin);
     const QString gppBin = p.value(optGppBin);
@@ -116,8 +303,16 @@ int main(int argc, char *argv[])
     if (!gppArgs.isEmpty()) {
         grinpp.setDefaultArgs(gppArgs);
     }
-    rust.setLogCapacity(logCap);
-    grinpp.setLogCapacity(logCap);
+    rust.setLogCapacity(rustLogBytes);
+    grinpp.setLogCapacity(grinppLogBytes);
+    rust.setLogMode(logMode);
+    grinpp.setLogMode(logMode);
+    rust.setLogNotifyInterval(logNotifyMs);
+    grinpp.setLogNotifyInterval(logNotifyMs);
+    rust.setChainPoll(nodeProxyPort, chainPollMs);
+    grinpp.setChainPoll(nodeProxyPort, chainPollMs);
+    rust.setProcSampling(procSampleMs, procHistory);
+    grinpp.setProcSampling(procSampleMs, procHistory);
 
     // ----------------------------
     // DataDirs
@@ -137,22 +332,79 @@ int main(int argc, char *argv[])
     }
     rust.setDataDir(rustDataDir);
 
+    // Spool lives in the data dir, so only after setDataDir
+    if (!rust.setLogSpool(logSpool)) {
+        qWarning().noquote() << QString("[!] Log spool for %1 unavailable").arg(rust.id());
+    }
+    if (!grinpp.setLogSpool(logSpool)) {
+        qWarning().noquote() << QString("[!] Log spool for %1 unavailable").arg(grinpp.id());
+    }
+
+    // ----------------------------
+    // Node thread
+    // ----------------------------
+    // start/stop wait for the process (up to 10 s); on their own thread this
+    // does not hold up accept() or the log streams on the main thread.
+    // HTTP handlers reach the nodes through HttpServer::callOnNode().
+    QThread nodeThread;
+    nodeThread.setObjectName("nodes");
+    rust.moveToThread(&nodeThread);
+    grinpp.moveToThread(&nodeThread);
+    nodeThread.start();
+
+    // The nodes are destroyed on this thread, bring them back first
+    auto stopNodeThread = [&] {
+        QThread *mainThread = app.thread();
+        QMetaObject::invokeMethod(&rust, [&rust, &grinpp, mainThread] {
+            rust.moveToThread(mainThread);
+            grinpp.moveToThread(mainThread);
+        }, Qt::BlockingQueuedConnection);
+        nodeThread.quit();
+        nodeThread.wait();
+    };
+
     // -------------------------------------------------------------------------------------------------------
     // HTTP Server start
     // -------------------------------------------------------------------------------------------------------
     HttpServer http;
     http.setNodeRpcPort(nodeProxyPort);
+    http.setWorkerCount(httpWorkers);
+    http.setUpstreamLimits(upstreamMax, upstreamQueue, upstreamQueueMs);
+    http.setCompression(compressMin, compressLevel, compressProxy);
+    http.setLogBudget(logTotal);
     http.registerNode(&rust);
     http.registerNode(&grinpp);
 
     if (!http.listen(port)) {
         qCritical().noquote() << QString("HTTP server could not bind to port %1.").arg(port);
+        stopNodeThread();
         return 1;
     }
 
     qInfo().noquote() << QString("[i] HTTP server listens on http://0.0.0.0:%1").arg(port);
-    qInfo().noquote() << QString("[i] Log-Capacity: %1 rows").arg(logCap);
+    qInfo().noquote() << QString("[i] Log-Capacity: %1 bytes (rust), %2 bytes (grinpp)%3")
+        .arg(rustLogBytes).arg(grinppLogBytes)
+        .arg(logTotal > 0 ? QString(", %1 bytes total").arg(logTotal) : QString());
+    qInfo().noquote() << QString("[i] Log mode: %1, notify every %2 ms").arg(logModeName).arg(logNotifyMs);
+    if (logSpool > 0) {
+        qInfo().noquote() << QString("[i] Log spool: %1 bytes per node").arg(logSpool);
+    }
     qInfo().noquote() << QString("[i] Proxy node port: %1").arg(nodeProxyPort);
+    if (chainPollMs > 0) {
+        qInfo().noquote() << QString("[i] Chain state poll: every %1 ms").arg(chainPollMs);
+    }
+    if (procSampleMs > 0 && ProcSampler::isSupported()) {
+        qInfo().noquote() << QString("[i] Process metrics: every %1 ms, %2 samples").arg(procSampleMs).arg(procHistory);
+    }
+    qInfo().noquote() << QString("[i] HTTP workers: %1").arg(http.workerCount());
+    qInfo().noquote() << QString("[i] Upstream per node: %1 concurrent, %2 queued, %3 ms queue timeout")
+        .arg(upstreamMax).arg(upstreamQueue).arg(upstreamQueueMs);
+    if (compressMin >= 0) {
+        qInfo().noquote() << QString("[i] Compression: gzip/deflate from %1 bytes, level %2, proxy streams %3")
+            .arg(compressMin).arg(compressLevel).arg(compressProxy ? "on" : "off");
+    } else {
+        qInfo().noquote() << QString("[i] Compression: off");
+    }
     if (!rustBin.isEmpty()) {
         qInfo().noquote() << QString("[i] Rust Node:  %1").arg(rustBin);
     }
@@ -160,5 +412,7 @@ int main(int argc, char *argv[])
         qInfo().noquote() << QString("[i] Grin++:     %1").arg(gppBin);
     }
 
-    return app.exec();
+    const int rc = app.exec();
+    stopNodeThread();
+    return rc;
 }
@@ -0,0 +1,142 @@
+#include "httpbodystream.h"
+
+#include <cstring>
+
+/**
+ * @brief HttpBodyStream::HttpBodyStream
+ * @param totalSize Content-Length of the request
+ * @param parent
+ */
+HttpBodyStream::HttpBodyStream(qint64 totalSize, QObject *parent) :
+    QIODevice(parent),
+    m_total(totalSize)
+{
+    // Own chunk list is the only buffer
+    open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+}
+
+/**
+ * @brief HttpBodyStream::append
+ * @param data
+ */
+void HttpBodyStream::append(const QByteArray &data)
+{
+    if (data.isEmpty()) {
+        return;
+    }
+
+    m_chunks.append(data);
+    m_received += data.size();
+    m_buffered += data.size();
+
+    emit readyRead();
+    if (isComplete()) {
+        emit readChannelFinished();
+    }
+}
+
+/**
+ * @brief HttpBodyStream::totalSize
+ * @return
+ */
+qint64 HttpBodyStream::totalSize() const
+{
+    return m_total;
+}
+
+/**
+ * @brief HttpBodyStream::remaining
+ * @return
+ */
+qint64 HttpBodyStream::remaining() const
+{
+    return m_total - m_received;
+}
+
+/**
+ * @brief HttpBodyStream::buffered
+ * @return
+ */
+qint64 HttpBodyStream::buffered() const
+{
+    return m_buffered;
+}
+
+/**
+ * @brief HttpBodyStream::isComplete
+ * @return
+ */
+bool HttpBodyStream::isComplete() const
+{
+    return m_received >= m_total;
+}
+
+/**
+ * @brief HttpBodyStream::isSequential
+ * @return
+ */
+bool HttpBodyStream::isSequential() const
+{
+    return true;
+}
+
+/**
+ * @brief HttpBodyStream::bytesAvailable
+ * @return
+ */
+qint64 HttpBodyStream::bytesAvailable() const
+{
+    return m_buffered + QIODevice::bytesAvailable();
+}
+
+/**
+ * @brief HttpBodyStream::atEnd
+ * @return
+ */
+bool HttpBodyStream::atEnd() const
+{
+    return isComplete() && m_buffered == 0;
+}
+
+/**
+ * @brief HttpBodyStream::readData
+ * @param data
+ * @param maxlen
+ * @return
+ */
+qint64 HttpBodyStream::readData(char *data, qint64 maxlen)
+{
+    qint64 copied = 0;
+    while (copied < maxlen && !m_chunks.isEmpty()) {
+        const QByteArray &head = m_chunks.constFirst();
+        const qint64 n = qMin<qint64>(maxlen - copied, head.size() - m_headPos);
+        std::memcpy(data + copied, head.constData() + m_headPos, size_t(n));
+        copied += n;
+        m_headPos += n;
+        if (m_headPos >= head.size()) {
+            m_chunks.removeFirst();
+            m_headPos = 0;
+        }
+    }
+    m_buffered -= copied;
+
+    if (copied == 0 && atEnd()) {
+        return -1;
+    }
+    if (copied > 0) {
+        emit consumed();
+    }
+    return copied;
+}
+
+/**
+ * @brief HttpBodyStream::writeData
+ * Read-only device.
+ * @return
+ */
+qint64 HttpBodyStream::writeData(const char *data, qint64 len)
+{
+    Q_UNUSED(data);
+    Q_UNUSED(len);
+    return -1;
+}
@@ -0,0 +1,47 @@
+#ifndef HTTPBODYSTREAM_H
+#define HTTPBODYSTREAM_H
+
+#include <QIODevice>
+#include <QByteArray>
+#include <QList>
+
+/**
+ * @brief The HttpBodyStream class
+ * Sequential read-only device for a request body of known length that is
+ * still arriving on the client socket. HttpConnection appends the received
+ * pieces, the consumer (e.g. a QNetworkReply upload) reads them as they come.
+ */
+class HttpBodyStream : public QIODevice
+{
+    Q_OBJECT
+public:
+    explicit HttpBodyStream(qint64 totalSize, QObject *parent = nullptr);
+
+    void append(const QByteArray &data);
+
+    qint64 totalSize() const;
+    qint64 remaining() const;   // bytes not yet received from the client
+    qint64 buffered() const;    // received, not yet read by the consumer
+    bool isComplete() const;
+
+    bool isSequential() const override;
+    qint64 bytesAvailable() const override;
+    bool atEnd() const override;
+
+signals:
+    // Consumer read data, more may be taken from the socket
+    void consumed();
+
+protected:
+    qint64 readData(char *data, qint64 maxlen) override;
+    qint64 writeData(const char *data, qint64 len) override;
+
+private:
+    qint64 m_total;
+    qint64 m_received = 0;
+    qint64 m_buffered = 0;
+    QList<QByteArray> m_chunks;
+    qsizetype m_headPos = 0;    // read offset in m_chunks.first()
+};
+
+#endif // HTTPBODYSTREAM_H
@@ -0,0 +1,270 @@
+#include "httpcompressor.h"
+#include "httprequest.h"
+
+#include <zlib.h>
+
+// Output grows in steps of this size while deflating
+static const qsizetype kOutputStep = 16 * 1024;
+
+/**
+ * @brief qValue
+ * Weight of one Accept-Encoding entry in thousandths ("gzip;q=0.5" -> 500).
+ * @param params everything behind the coding name
+ * @return
+ */
+static int qValue(QByteArrayView params)
+{
+    qsizetype pos = 0;
+    while (pos < params.size()) {
+        qsizetype end = params.indexOf(';', pos);
+        if (end < 0) {
+            end = params.size();
+        }
+        const QByteArrayView param = params.sliced(pos, end - pos).trimmed();
+        if (param.size() >= 2 && (param[0] == 'q' || param[0] == 'Q') && param[1] == '=') {
+            const QByteArrayView v = param.sliced(2);
+            if (v.isEmpty() || v[0] != '0') {
+                return 1000;
+            }
+            int q = 0;
+            int scale = 100;
+            for (qsizetype i = 2; i < v.size() && scale > 0; ++i) {
+                if (v[i] < '0' || v[i] > '9') {
+                    break;
+                }
+                q += (v[i] - '0') * scale;
+                scale /= 10;
+            }
+            return q;
+        }
+        pos = end + 1;
+    }
+    return 1000;
+}
+
+/**
+ * @brief HttpCompressor::HttpCompressor
+ * @param encoding Gzip or Deflate
+ * @param level
+ */
+HttpCompressor::HttpCompressor(Encoding encoding, int level) :
+    m_zs(new z_stream),
+    m_encoding(encoding)
+{
+    *m_zs = z_stream();
+    if (encoding == Encoding::Identity) {
+        return;
+    }
+
+    // 15 = 32K window; +16 writes a gzip header/trailer instead of the zlib
+    // wrapper, which is what HTTP calls "deflate"
+    const int windowBits = (encoding == Encoding::Gzip) ? 15 + 16 : 15;
+    m_valid = deflateInit2(m_zs, qBound(1, level, 9), Z_DEFLATED, windowBits, 8, Z_DEFAULT_STRATEGY) == Z_OK;
+}
+
+/**
+ * @brief HttpCompressor::~HttpCompressor
+ */
+HttpCompressor::~HttpCompressor()
+{
+    if (m_valid) {
+        deflateEnd(m_zs);
+    }
+    delete m_zs;
+}
+
+/**
+ * @brief HttpCompressor::isValid
+ * @return
+ */
+bool HttpCompressor::isValid() const
+{
+    return m_valid;
+}
+
+/**
+ * @brief HttpCompressor::encoding
+ * @return
+ */
+HttpCompressor::Encoding HttpCompressor::encoding() const
+{
+    return m_encoding;
+}
+
+/**
+ * @brief HttpCompressor::compress
+ * @param data
+ * @return
+ */
+QByteArray HttpCompressor::compress(QByteArrayView data)
+{
+    if (!m_valid || m_finished || data.isEmpty()) {
+        return QByteArray();
+    }
+    return run(data, Z_SYNC_FLUSH, data.size() / 2 + 64);
+}
+
+/**
+ * @brief HttpCompressor::finish
+ * @return
+ */
+QByteArray HttpCompressor::finish()
+{
+    if (!m_valid || m_finished) {
+        return QByteArray();
+    }
+    m_finished = true;
+    return run(QByteArrayView(), Z_FINISH, 64);
+}
+
+/**
+ * @brief HttpCompressor::run
+ * @param data
+ * @param flush
+ * @param sizeHint first output allocation
+ * @return
+ */
+QByteArray HttpCompressor::run(QByteArrayView data, int flush, qsizetype sizeHint)
+{
+    QByteArray out;
+    out.resize(qMax<qsizetype>(sizeHint, 64));
+    qsizetype used = 0;
+
+    m_zs->next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data.data()));
+    m_zs->avail_in = uInt(data.size());
+
+    for (;;) {
+        if (used == out.size()) {
+            out.resize(out.size() + kOutputStep);
+        }
+        m_zs->next_out = reinterpret_cast<Bytef *>(out.data() + used);
+        m_zs->avail_out = uInt(out.size() - used);
+
+        const int rc = deflate(m_zs, flush);
+        if (rc == Z_STREAM_ERROR) {
+            m_valid = false;
+            return QByteArray();
+        }
+        used = out.size() - m_zs->avail_out;
+
+        // Done once zlib leaves room in the output (or ends the stream)
+        if (rc == Z_STREAM_END || (m_zs->avail_out != 0 && flush != Z_FINISH)) {
+            break;
+        }
+        if (rc == Z_BUF_ERROR && m_zs->avail_out != 0) {
+            break;
+        }
+    }
+
+    out.truncate(used);
+    return out;
+}
+
+/**
+ * @brief HttpCompressor::negotiate
+ * gzip wins over deflate at equal weight; "*" stands for gzip.
+ * @param acceptEncoding
+ * @return
+ */
+HttpCompressor::Encoding HttpCompressor::negotiate(QByteArrayView acceptEncoding)
+{
+    int gzip = -1;
+    int deflate = -1;
+    int any = -1;
+
+    qsizetype pos = 0;
+    while (pos < acceptEncoding.size()) {
+        qsizetype end = acceptEncoding.indexOf(',', pos);
+        if (end < 0) {
+            end = acceptEncoding.size();
+        }
+        const QByteArrayView item = acceptEncoding.sliced(pos, end - pos).trimmed();
+        pos = end + 1;
+
+        const qsizetype semi = item.indexOf(';');
+        const QByteArrayView name = (semi < 0 ? item : item.first(semi)).trimmed();
+        const int q = (semi < 0) ? 1000 : qValue(item.sliced(semi + 1));
+
+        if (HttpRequest::equalsIgnoreCase(name, "gzip") || HttpRequest::equalsIgnoreCase(name, "x-gzip")) {
+            gzip = q;
+        } else if (HttpRequest::equalsIgnoreCase(name, "deflate")) {
+            deflate = q;
+        } else if (name == "*") {
+            any = q;
+        }
+    }
+
+    if (gzip < 0) {
+        gzip = any;
+    }
+    if (deflate < 0) {
+        deflate = any;
+    }
+    if (gzip > 0 && gzip >= deflate) {
+        return Encoding::Gzip;
+    }
+    if (deflate > 0) {
+        return Encoding::Deflate;
+    }
+    return Encoding::Identity;
+}
+
+/**
+ * @brief HttpCompressor::token
+ * @param encoding
+ * @return Content-Encoding value
+ */
+QByteArrayView HttpCompressor::token(Encoding encoding)
+{
+    switch (encoding) {
+    case Encoding::Gzip:
+        return "gzip";
+    case Encoding::Deflate:
+        return "deflate";
+    case Encoding::Identity:
+        break;
+    }
+    return "identity";
+}
+
+/**
+ * @brief HttpCompressor::etagSuffix
+ * Appended to the opaque part of an entity tag, a compressed body is a
+ * different representation than the identity one (RFC 9110, 8.8.3.3).
+ * @param encoding
+ * @return
+ */
+QByteArrayView HttpCompressor::etagSuffix(Encoding encoding)
+{
+    switch (encoding) {
+    case Encoding::Gzip:
+        return "-gz";
+    case Encoding::Deflate:
+        return "-deflate";
+    case Encoding::Identity:
+        break;
+    }
+    return QByteArrayView();
+}
+
+/**
+ * @brief HttpCompressor::compressAll
+ * @param data
+ * @param encoding
+ * @param level
+ * @param ok
+ * @return complete compressed body
+ */
+QByteArray HttpCompressor::compressAll(QByteArrayView data, Encoding encoding, int level, bool *ok)
+{
+    HttpCompressor c(encoding, level);
+    QByteArray out;
+    if (c.isValid()) {
+        c.m_finished = true;
+        out = c.run(data, Z_FINISH, qsizetype(deflateBound(c.m_zs, uLong(data.size()))));
+    }
+    if (ok) {
+        *ok = c.isValid();
+    }
+    return out;
+}
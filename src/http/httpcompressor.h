@@ -0,0 +1,57 @@
+#ifndef HTTPCOMPRESSOR_H
+#define HTTPCOMPRESSOR_H
+
+#include <QByteArray>
+#include <QByteArrayView>
+
+struct z_stream_s;
+
+/**
+ * @brief The HttpCompressor class
+ * gzip / deflate content coding on top of zlib. One instance compresses
+ * one response body, either in one go or chunk by chunk for streamed
+ * responses (every chunk is sync-flushed so the client sees it at once).
+ */
+class HttpCompressor
+{
+public:
+    enum class Encoding {
+        Identity,
+        Gzip,
+        Deflate
+    };
+
+    struct Options {
+        int minBytes = 1024;    // smaller bodies are sent raw, < 0 disables compression
+        int level = 6;          // zlib level 1..9
+        bool streams = false;   // compress streamed (proxied) responses as well
+    };
+
+    HttpCompressor(Encoding encoding, int level);
+    ~HttpCompressor();
+
+    HttpCompressor(const HttpCompressor &) = delete;
+    HttpCompressor &operator=(const HttpCompressor &) = delete;
+
+    bool isValid() const;
+    Encoding encoding() const;
+
+    QByteArray compress(QByteArrayView data);   // flushed, may be empty for empty input
+    QByteArray finish();                        // trailer, the stream is done afterwards
+
+    // Preferred coding of an Accept-Encoding header, Identity if none fits
+    static Encoding negotiate(QByteArrayView acceptEncoding);
+    static QByteArrayView token(Encoding encoding);
+    static QByteArrayView etagSuffix(Encoding encoding);    // "-gz", "-deflate", empty for identity
+    static QByteArray compressAll(QByteArrayView data, Encoding encoding, int level, bool *ok = nullptr);
+
+private:
+    QByteArray run(QByteArrayView data, int flush, qsizetype sizeHint);
+
+    z_stream_s *m_zs;
+    Encoding m_encoding;
+    bool m_valid = false;
+    bool m_finished = false;
+};
+
+#endif // HTTPCOMPRESSOR_H
@@ -0,0 +1,722 @@
+#include "httpconnection.h"
+#include "httpworker.h"
+#include "httpmetrics.h"
+
+#include <QDebug>
+
+#include <cstdarg>
+
+#ifdef Q_OS_LINUX
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <cerrno>
+#endif
+
+// Max. time between two reads before an unfinished request is dropped
+static const int kRequestTimeoutMs = 5000;
+// Idle time on a persistent connection before it is closed
+static const int kKeepAliveTimeoutMs = 15000;
+// Requests served on one connection before it is closed
+static const int kMaxRequestsPerConnection = 1000;
+// Bytes QTcpSocket buffers while a response is pending (TCP backpressure)
+static const qint64 kReadBufferSize = 256 * 1024;
+// Streamed responses: emit drained() once the send buffer is below this
+static const qint64 kLowWatermark = 64 * 1024;
+
+/**
+ * @brief hasToken
+ * Case-insensitive search in a comma separated header value.
+ * @param value
+ * @param token
+ * @return
+ */
+static bool hasToken(QByteArrayView value, QByteArrayView token)
+{
+    qsizetype start = 0;
+    while (start <= value.size()) {
+        qsizetype end = value.indexOf(',', start);
+        if (end < 0) {
+            end = value.size();
+        }
+        if (HttpRequest::equalsIgnoreCase(value.sliced(start, end - start).trimmed(), token)) {
+            return true;
+        }
+        start = end + 1;
+    }
+    return false;
+}
+
+/**
+ * @brief HttpConnection::HttpConnection
+ * @param socket
+ * @param handler
+ * @param worker
+ */
+HttpConnection::HttpConnection(QTcpSocket *socket, HttpRequestHandler *handler, HttpWorker *worker) :
+    QObject(worker),
+    m_socket(socket),
+    m_handler(handler),
+    m_worker(worker)
+{
+    m_socket->setParent(this);
+    m_socket->setReadBufferSize(kReadBufferSize);
+
+    m_timer.setSingleShot(true);
+
+    connect(m_socket, &QTcpSocket::readyRead, this, &HttpConnection::onReadyRead);
+    connect(m_socket, &QTcpSocket::disconnected, this, &HttpConnection::onDisconnected);
+    connect(m_socket, &QTcpSocket::bytesWritten, this, &HttpConnection::onBytesWritten);
+    connect(&m_timer, &QTimer::timeout, this, &HttpConnection::onTimeout);
+
+    m_timer.start(kRequestTimeoutMs);
+
+    // Data may already be buffered before readyRead was connected
+    if (m_socket->bytesAvailable() > 0) {
+        QMetaObject::invokeMethod(this, &HttpConnection::onReadyRead, Qt::QueuedConnection);
+    }
+}
+
+/**
+ * @brief HttpConnection::socket
+ * @return
+ */
+QTcpSocket *HttpConnection::socket() const
+{
+    return m_socket;
+}
+
+/**
+ * @brief HttpConnection::worker
+ * @return
+ */
+HttpWorker *HttpConnection::worker() const
+{
+    return m_worker;
+}
+
+/**
+ * @brief HttpConnection::keepAlive
+ * @return
+ */
+bool HttpConnection::keepAlive() const
+{
+    return m_keepAlive;
+}
+
+/**
+ * @brief HttpConnection::isClosed
+ * @return true once the peer disconnected
+ */
+bool HttpConnection::isClosed() const
+{
+    return m_closed;
+}
+
+/**
+ * @brief HttpConnection::sendResponse
+ * @param response
+ * @param body
+ */
+void HttpConnection::sendResponse(const HttpResponse &response, const QByteArray &body)
+{
+    if (!m_busy) {
+        qWarning() << "[http] response without pending request dropped";
+        return;
+    }
+    m_responseStatus = response.statusCode();
+
+    const HttpCompressor::Options &opts = m_worker->compression();
+    HttpCompressor::Encoding encoding = HttpCompressor::Encoding::Identity;
+    QByteArray payload = body;
+    qint64 contentLength = response.contentLength();
+
+    if (opts.minBytes >= 0 && body.size() >= opts.minBytes && contentLength == body.size()) {
+        encoding = acceptedEncoding();
+        if (encoding != HttpCompressor::Encoding::Identity) {
+            bool ok = false;
+            const QByteArray packed = HttpCompressor::compressAll(body, encoding, opts.level, &ok);
+            if (ok && packed.size() < body.size()) {
+                payload = packed;
+                contentLength = packed.size();
+            } else {
+                encoding = HttpCompressor::Encoding::Identity;
+            }
+        }
+    }
+
+    QVarLengthArray<char, 256> tail;
+    writeSegments({ response.prebuilt(), response.headers(),
+                    formatHeadTail(tail, contentLength, false, encoding, response.etag()),
+                    payload });
+    m_socket->flush();
+    m_headNs = m_requestTimer.nsecsElapsed();
+
+    finishResponse();
+}
+
+/**
+ * @brief HttpConnection::beginResponse
+ * @param response without Content-Length
+ */
+void HttpConnection::beginResponse(const HttpResponse &response)
+{
+    if (!m_busy || m_streaming) {
+        qWarning() << "[http] streamed response without pending request dropped";
+        return;
+    }
+
+    m_streaming = true;
+    m_responseStatus = response.statusCode();
+    // Streams stay open for hours, their latency is the time to the head
+    m_headNs = m_requestTimer.nsecsElapsed();
+    m_chunked = !m_request.isHttp10();
+    if (!m_chunked) {
+        // HTTP/1.0: end of body = end of connection
+        m_keepAlive = false;
+    }
+
+    const HttpCompressor::Options &opts = m_worker->compression();
+    HttpCompressor::Encoding encoding = HttpCompressor::Encoding::Identity;
+    // Event streams share one payload between all subscribers, see LogStreamHub
+    if (opts.streams && opts.minBytes >= 0 && response.contentType() != HttpResponse::ContentType::EventStream) {
+        encoding = acceptedEncoding();
+        if (encoding != HttpCompressor::Encoding::Identity) {
+            m_compressor.reset(new HttpCompressor(encoding, opts.level));
+            if (!m_compressor->isValid()) {
+                m_compressor.reset();
+                encoding = HttpCompressor::Encoding::Identity;
+            }
+        }
+    }
+
+    QVarLengthArray<char, 256> tail;
+    writeSegments({ response.prebuilt(), response.headers(),
+                    formatHeadTail(tail, -1, m_chunked, encoding) });
+}
+
+/**
+ * @brief HttpConnection::writeChunk
+ * @param data
+ */
+void HttpConnection::writeChunk(const QByteArray &data)
+{
+    // An empty chunk would terminate the body
+    if (!m_streaming || data.isEmpty()) {
+        return;
+    }
+
+    writeBody(m_compressor ? m_compressor->compress(data) : data);
+}
+
+/**
+ * @brief HttpConnection::writeBody
+ * One piece of a streamed body, framed as a chunk if needed.
+ * @param data
+ */
+void HttpConnection::writeBody(const QByteArray &data)
+{
+    if (data.isEmpty()) {
+        return;
+    }
+
+    if (m_chunked) {
+        char size[24];
+        const int n = qsnprintf(size, sizeof(size), "%llx\r\n", static_cast<unsigned long long>(data.size()));
+        writeSegments({ QByteArrayView(size, n), data, QByteArrayView("\r\n", 2) });
+    } else {
+        m_socket->write(data);
+        HttpMetrics::instance()->addBytesOut(data.size());
+    }
+}
+
+/**
+ * @brief HttpConnection::endResponse
+ */
+void HttpConnection::endResponse()
+{
+    if (!m_streaming) {
+        return;
+    }
+
+    if (m_compressor) {
+        writeBody(m_compressor->finish());
+    }
+    if (m_chunked) {
+        m_socket->write("0\r\n\r\n", 5);
+        HttpMetrics::instance()->addBytesOut(5);
+    }
+    m_streaming = false;
+    m_socket->flush();
+
+    finishResponse();
+}
+
+/**
+ * @brief HttpConnection::abortResponse
+ * Gives up on the current response; the connection is closed without the
+ * final chunk so the client can tell the body is incomplete.
+ */
+void HttpConnection::abortResponse()
+{
+    if (!m_busy) {
+        return;
+    }
+
+    m_streaming = false;
+    m_keepAlive = false;
+    finishResponse();
+}
+
+/**
+ * @brief HttpConnection::pendingBytes
+ * @return
+ */
+qint64 HttpConnection::pendingBytes() const
+{
+    return m_socket->bytesToWrite();
+}
+
+/**
+ * @brief HttpConnection::requestBody
+ * @return
+ */
+HttpBodyStream *HttpConnection::requestBody() const
+{
+    return m_bodyStream;
+}
+
+/**
+ * @brief HttpConnection::setMetricsRoute
+ * @param route
+ */
+void HttpConnection::setMetricsRoute(int route)
+{
+    m_metricsRoute = route;
+}
+
+/**
+ * @brief HttpConnection::restartRequestTimer
+ */
+void HttpConnection::restartRequestTimer()
+{
+    m_requestTimer.start();
+}
+
+/**
+ * @brief HttpConnection::onBytesWritten
+ */
+void HttpConnection::onBytesWritten()
+{
+    if (m_streaming && m_socket->bytesToWrite() <= kLowWatermark) {
+        emit drained();
+    }
+}
+
+/**
+ * @brief HttpConnection::feedBodyStream
+ * Moves body bytes from the socket into the stream, at most one read
+ * buffer ahead of the consumer.
+ */
+void HttpConnection::feedBodyStream()
+{
+    if (!m_bodyStream || m_state != State::StreamBody) {
+        return;
+    }
+
+    while (m_bodyStream->buffered() < kReadBufferSize && m_socket->bytesAvailable() > 0) {
+        const qint64 want = qMin(m_bodyStream->remaining(), kReadBufferSize - m_bodyStream->buffered());
+        const QByteArray data = m_socket->read(want);
+        if (data.isEmpty()) {
+            break;
+        }
+        HttpMetrics::instance()->addBytesIn(data.size());
+        m_bodyStream->append(data);
+        if (m_bodyStream->isComplete()) {
+            // Anything after the body stays in the socket for the next request
+            m_state = State::Head;
+            break;
+        }
+    }
+}
+
+/**
+ * @brief HttpConnection::onReadyRead
+ */
+void HttpConnection::onReadyRead()
+{
+    if (m_state == State::StreamBody) {
+        feedBodyStream();
+        return;
+    }
+
+    // While a response is pending the bytes stay in the socket; they are
+    // picked up again by processBuffer() once the response is out.
+    if (m_busy) {
+        return;
+    }
+    if (m_state == State::Closing) {
+        HttpMetrics::instance()->addBytesIn(m_socket->readAll().size());
+        return;
+    }
+    processBuffer();
+}
+
+/**
+ * @brief HttpConnection::onDisconnected
+ */
+void HttpConnection::onDisconnected()
+{
+    m_closed = true;
+    m_timer.stop();
+    emit closed();
+
+    // A handler may still hold the connection (e.g. while waiting for the proxy)
+    if (!m_dispatching && !m_busy) {
+        deleteLater();
+    }
+}
+
+/**
+ * @brief HttpConnection::onTimeout
+ */
+void HttpConnection::onTimeout()
+{
+    if (m_busy || m_state == State::Closing) {
+        return;
+    }
+
+    if (m_state == State::Head && m_buffer.isEmpty()) {
+        // Idle keep-alive connection
+        m_state = State::Closing;
+        m_socket->disconnectFromHost();
+        return;
+    }
+    reject(400, QStringLiteral("request timeout"));
+}
+
+/**
+ * @brief HttpConnection::processBuffer
+ * Parses and dispatches as many buffered requests as possible, one at a time.
+ */
+void HttpConnection::processBuffer()
+{
+    while (!m_busy && !m_closed && m_state != State::Closing && m_state != State::StreamBody) {
+        const qsizetype before = m_buffer.size();
+        m_buffer += m_socket->readAll();
+        HttpMetrics::instance()->addBytesIn(m_buffer.size() - before);
+
+        if (m_state == State::Head) {
+            const HttpRequestParser::Result res = m_parser.parse(m_buffer, m_request);
+            if (res == HttpRequestParser::Result::Error) {
+                reject(m_parser.errorStatus(), m_parser.errorMessage());
+                return;
+            }
+            if (res == HttpRequestParser::Result::NeedMore) {
+                break;
+            }
+            m_state = State::Body;
+
+            // Only shares the buffer; dropped again unless the body is streamed
+            m_request.raw = m_buffer;
+            const int headSize = m_parser.headSize();
+            const qint64 contentLength = m_parser.contentLength();
+
+            if (contentLength > 0 && m_handler->streamsRequestBody(m_request)) {
+                // Dispatch now, the body follows through requestBody()
+                const qint64 avail = qMin<qint64>(m_buffer.size() - headSize, contentLength);
+                m_bodyStream = new HttpBodyStream(contentLength, this);
+                connect(m_bodyStream, &HttpBodyStream::consumed,
+                        this, &HttpConnection::feedBodyStream, Qt::QueuedConnection);
+                m_bodyStream->append(m_buffer.mid(headSize, int(avail)));
+                consumeBuffer(headSize + int(avail));
+                m_parser.reset();
+                m_state = m_bodyStream->isComplete() ? State::Head : State::StreamBody;
+
+                dispatch();
+                continue;
+            }
+            m_request.raw = QByteArray();
+        }
+
+        const int total = m_parser.headSize() + int(m_parser.contentLength());
+        if (m_buffer.size() < total) {
+            break;
+        }
+
+        // Head and body stay in the receive buffer, the request refers to it
+        m_request.raw = m_buffer;
+        m_request.bodySpan = { m_parser.headSize(), int(m_parser.contentLength()) };
+        consumeBuffer(total);
+        m_parser.reset();
+        m_state = State::Head;
+
+        dispatch();
+    }
+
+    if (!m_busy && m_state != State::Closing) {
+        armTimer();
+    }
+}
+
+/**
+ * @brief HttpConnection::consumeBuffer
+ * Drops the bytes of the current request. Only pipelined bytes behind it
+ * are copied, the request keeps the old buffer.
+ * @param n
+ */
+void HttpConnection::consumeBuffer(int n)
+{
+    if (n >= m_buffer.size()) {
+        m_buffer = QByteArray();
+    } else {
+        m_buffer = m_buffer.mid(n);
+    }
+}
+
+/**
+ * @brief HttpConnection::dispatch
+ */
+void HttpConnection::dispatch()
+{
+    m_timer.stop();
+    ++m_requestCount;
+    m_keepAlive = wantsKeepAlive();
+    m_busy = true;
+    m_metricsRoute = 0;
+    m_responseStatus = 0;
+    m_requestTimer.start();
+    m_headNs = -1;
+
+    m_dispatching = true;
+    m_handler->handleRequest(this, m_request);
+    m_dispatching = false;
+
+    if (m_closed && !m_busy) {
+        deleteLater();
+    }
+}
+
+/**
+ * @brief HttpConnection::reject
+ * @param statusCode
+ * @param msg
+ */
+void HttpConnection::reject(int statusCode, const QString &msg)
+{
+    m_timer.stop();
+    m_buffer.clear();
+    // May be half parsed; nothing of it must be looked at for the answer
+    m_request = HttpRequest();
+    m_keepAlive = false;
+    m_busy = true;
+    m_metricsRoute = 0;
+    m_responseStatus = 0;
+    m_requestTimer.start();
+    m_headNs = -1;
+
+    m_handler->rejectRequest(this, statusCode, msg);
+}
+
+/**
+ * @brief HttpConnection::finishResponse
+ */
+void HttpConnection::finishResponse()
+{
+    // Aborted before a head was written (client gone): counted, no latency
+    HttpMetrics::instance()->observeRequest(m_metricsRoute, m_responseStatus, m_headNs);
+    m_busy = false;
+    m_streaming = false;
+    m_compressor.reset();
+
+    if (m_bodyStream) {
+        m_bodyStream->deleteLater();
+        m_bodyStream = nullptr;
+    }
+    if (m_state == State::StreamBody) {
+        m_keepAlive = false;
+    }
+
+    if (!m_keepAlive || m_closed) {
+        m_state = State::Closing;
+        m_timer.stop();
+        m_socket->disconnectFromHost();
+        if (m_closed && !m_dispatching) {
+            deleteLater();
+        }
+        return;
+    }
+
+    // Asynchronous response: continue with pipelined requests. A response
+    // sent from within dispatch() returns to the loop in processBuffer().
+    if (!m_dispatching) {
+        processBuffer();
+    }
+}
+
+/**
+ * @brief HttpConnection::armTimer
+ */
+void HttpConnection::armTimer()
+{
+    m_timer.start(m_buffer.isEmpty() ? kKeepAliveTimeoutMs : kRequestTimeoutMs);
+}
+
+/**
+ * @brief appendFormat
+ * printf into the free space of buf, grows it when the text does not fit
+ * (an overlong ETag), so the head is never cut off.
+ * @param buf
+ * @param fmt
+ */
+static void appendFormat(QVarLengthArray<char, 256> &buf, const char *fmt, ...) Q_ATTRIBUTE_FORMAT_PRINTF(2, 3);
+static void appendFormat(QVarLengthArray<char, 256> &buf, const char *fmt, ...)
+{
+    const qsizetype used = buf.size();
+    buf.resize(buf.capacity());
+
+    va_list ap;
+    va_start(ap, fmt);
+    va_list retry;
+    va_copy(retry, ap);
+    int n = qvsnprintf(buf.data() + used, size_t(buf.size() - used), fmt, ap);
+    if (n >= buf.size() - used) {
+        buf.resize(used + n + 1);
+        n = qvsnprintf(buf.data() + used, size_t(n + 1), fmt, retry);
+    }
+    va_end(retry);
+    va_end(ap);
+
+    buf.resize(used + qMax(n, 0));
+}
+
+/**
+ * @brief HttpConnection::formatHeadTail
+ * Content-Length / Transfer-Encoding, the Connection headers and the empty
+ * line, formatted into buf.
+ * @param buf stack buffer of the caller, must outlive the returned view
+ * @param contentLength -1 to omit
+ * @param chunked
+ * @param encoding content coding of the body
+ * @param etag quoted tag of the identity body, the coding is appended
+ * @return
+ */
+QByteArrayView HttpConnection::formatHeadTail(QVarLengthArray<char, 256> &buf, qint64 contentLength, bool chunked,
+                                              HttpCompressor::Encoding encoding, QByteArrayView etag)
+{
+    if (m_state == State::StreamBody) {
+        // Unread request body still on the wire, the connection cannot be reused
+        m_keepAlive = false;
+    }
+
+    buf.clear();
+    if (contentLength >= 0) {
+        appendFormat(buf, "Content-Length: %lld\r\n", static_cast<long long>(contentLength));
+    }
+    if (chunked) {
+        appendFormat(buf, "Transfer-Encoding: chunked\r\n");
+    }
+    if (etag.size() >= 2 && etag.endsWith('"')) {
+        // "<tag>" -> "<tag>-gz": gzip bytes must not validate against identity bytes
+        const QByteArrayView suffix = HttpCompressor::etagSuffix(encoding);
+        appendFormat(buf, "ETag: %.*s%.*s\"\r\n",
+                     int(etag.size() - 1), etag.data(), int(suffix.size()), suffix.data());
+    }
+    if (encoding != HttpCompressor::Encoding::Identity) {
+        const QByteArrayView token = HttpCompressor::token(encoding);
+        appendFormat(buf, "Content-Encoding: %.*s\r\nVary: Accept-Encoding\r\n",
+                     int(token.size()), token.data());
+    }
+    if (m_keepAlive) {
+        appendFormat(buf, "Connection: keep-alive\r\nKeep-Alive: timeout=%d, max=%d\r\n\r\n",
+                     kKeepAliveTimeoutMs / 1000, kMaxRequestsPerConnection - m_requestCount);
+    } else {
+        appendFormat(buf, "Connection: close\r\n\r\n");
+    }
+    return QByteArrayView(buf.constData(), buf.size());
+}
+
+/**
+ * @brief HttpConnection::acceptedEncoding
+ * @return
+ */
+HttpCompressor::Encoding HttpConnection::acceptedEncoding() const
+{
+    return HttpCompressor::negotiate(m_request.header("accept-encoding"));
+}
+
+/**
+ * @brief HttpConnection::writeSegments
+ * Writes the buffers in order without joining them. On Linux, when nothing
+ * is queued in the socket, they go out with a single sendmsg() (gather
+ * write); whatever the kernel does not take is queued in QTcpSocket.
+ * @param parts
+ */
+void HttpConnection::writeSegments(std::initializer_list<QByteArrayView> parts)
+{
+    qsizetype total = 0;
+    for (const QByteArrayView &p : parts) {
+        total += p.size();
+    }
+    HttpMetrics::instance()->addBytesOut(total);
+
+    auto it = parts.begin();
+    qsizetype skip = 0;
+
+#ifdef Q_OS_LINUX
+    if (m_socket->bytesToWrite() == 0 && m_socket->state() == QAbstractSocket::ConnectedState) {
+        iovec iov[8];
+        int count = 0;
+        for (const QByteArrayView &p : parts) {
+            if (!p.isEmpty() && count < 8) {
+                iov[count].iov_base = const_cast<char *>(p.data());
+                iov[count].iov_len = size_t(p.size());
+                ++count;
+            }
+        }
+
+        msghdr msg = {};
+        msg.msg_iov = iov;
+        msg.msg_iovlen = size_t(count);
+
+        ssize_t written;
+        do {
+            written = ::sendmsg(int(m_socket->socketDescriptor()), &msg, MSG_NOSIGNAL);
+        } while (written < 0 && errno == EINTR);
+
+        // Errors (EAGAIN, EPIPE, ...) are left to QTcpSocket, which retries
+        // or reports them through its usual signals
+        qsizetype left = written > 0 ? qsizetype(written) : 0;
+        while (it != parts.end() && left >= it->size()) {
+            left -= it->size();
+            ++it;
+        }
+        skip = left;
+    }
+#endif
+
+    for (; it != parts.end(); ++it) {
+        if (it->size() > skip) {
+            m_socket->write(it->data() + skip, it->size() - skip);
+        }
+        skip = 0;
+    }
+}
+
+/**
+ * @brief HttpConnection::wantsKeepAlive
+ * HTTP/1.1 defaults to persistent connections, HTTP/1.0 only with an
+ * explicit "Connection: keep-alive".
+ * @return
+ */
+bool HttpConnection::wantsKeepAlive() const
+{
+    if (m_requestCount >= kMaxRequestsPerConnection) {
+        return false;
+    }
+
+    const QByteArrayView conn = m_request.header("connection");
+    if (m_request.isHttp10()) {
+        return hasToken(conn, "keep-alive");
+    }
+    return !hasToken(conn, "close");
+}
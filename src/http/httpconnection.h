@@ -0,0 +1,151 @@
+#ifndef HTTPCONNECTION_H
+#define HTTPCONNECTION_H
+
+#include <QObject>
+#include <QTcpSocket>
+#include <QTimer>
+#include <QByteArray>
+#include <QString>
+#include <QScopedPointer>
+#include <QElapsedTimer>
+#include <QVarLengthArray>
+
+#include <initializer_list>
+
+#include "httprequest.h"
+#include "httpresponse.h"
+#include "httpbodystream.h"
+#include "httpcompressor.h"
+#include "httprequestparser.h"
+
+class HttpConnection;
+class HttpWorker;
+
+/**
+ * @brief The HttpRequestHandler class Interface
+ * Receives complete requests from a HttpConnection. Requests for which
+ * streamsRequestBody() returns true are dispatched right after the header
+ * block; their body is then read from HttpConnection::requestBody().
+ */
+class HttpRequestHandler
+{
+public:
+    virtual ~HttpRequestHandler() = default;
+
+    virtual void handleRequest(HttpConnection *c, const HttpRequest &r) = 0;
+    virtual void rejectRequest(HttpConnection *c, int statusCode, const QString &msg) = 0;
+    virtual bool streamsRequestBody(const HttpRequest &r) const
+    {
+        Q_UNUSED(r);
+        return false;
+    }
+};
+
+/**
+ * @brief The HttpConnection class
+ * Per-connection state: collects bytes on readyRead, parses header and body
+ * incrementally and dispatches the request once it is complete. Never blocks
+ * the event loop.
+ *
+ * Connections are persistent (HTTP/1.1 keep-alive). Pipelined requests stay
+ * in the receive buffer until the response to the previous one has been
+ * sent, so responses always go out in request order.
+ */
+class HttpConnection : public QObject
+{
+    Q_OBJECT
+public:
+    // The worker is the parent and outlives all of its connections
+    explicit HttpConnection(QTcpSocket *socket, HttpRequestHandler *handler, HttpWorker *worker);
+
+    QTcpSocket *socket() const;
+    HttpWorker *worker() const;
+
+    // Response for the current request. Content-Length, the Connection
+    // header and the empty line are added here. Bodies above the worker's
+    // threshold are compressed if the client accepts gzip or deflate.
+    void sendResponse(const HttpResponse &response, const QByteArray &body = QByteArray());
+    bool keepAlive() const;
+    bool isClosed() const;
+
+    // Streamed response of unknown length: chunked transfer encoding for
+    // HTTP/1.1, plain body + close for HTTP/1.0. Compressed on the fly if
+    // enabled for streams and accepted by the client.
+    void beginResponse(const HttpResponse &response);
+    void writeChunk(const QByteArray &data);
+    void endResponse();
+    void abortResponse();
+    qint64 pendingBytes() const;    // written, not yet on the wire
+
+    // Body of the current request while it is still arriving, nullptr if the
+    // body was buffered into HttpRequest::body.
+    HttpBodyStream *requestBody() const;
+
+    // HttpMetrics route id of the current request, set by the handler
+    void setMetricsRoute(int route);
+    // Latency starts over, e.g. when a held long-poll wakes up
+    void restartRequestTimer();
+
+signals:
+    // Peer went away; pending asynchronous work for this connection can be dropped
+    void closed();
+    // Send buffer fell below the low watermark during a streamed response
+    void drained();
+
+private slots:
+    void onReadyRead();
+    void onDisconnected();
+    void onTimeout();
+    void onBytesWritten();
+    void feedBodyStream();
+
+private:
+    enum class State {
+        Head,   // waiting for end of header block
+        Body,   // waiting for Content-Length bytes
+        StreamBody, // request dispatched, body forwarded to m_bodyStream
+        Closing // response with "Connection: close" sent
+    };
+
+    void processBuffer();
+    void consumeBuffer(int n);
+    void dispatch();
+    void reject(int statusCode, const QString &msg);
+    void finishResponse();
+    void armTimer();
+    bool wantsKeepAlive() const;
+    QByteArrayView formatHeadTail(QVarLengthArray<char, 256> &buf, qint64 contentLength, bool chunked,
+                                  HttpCompressor::Encoding encoding, QByteArrayView etag = QByteArrayView());
+    HttpCompressor::Encoding acceptedEncoding() const;
+    void writeBody(const QByteArray &data);
+    void writeSegments(std::initializer_list<QByteArrayView> parts);
+
+    QTcpSocket *m_socket;
+    HttpRequestHandler *m_handler;
+    HttpWorker *m_worker;
+    QTimer m_timer;
+
+    State m_state = State::Head;
+    QByteArray m_buffer;        // starts at the request being parsed
+    HttpRequestParser m_parser;
+    HttpRequest m_request;
+    int m_requestCount = 0;
+
+    HttpBodyStream *m_bodyStream = nullptr;
+    QScopedPointer<HttpCompressor> m_compressor;    // streamed response only
+
+    bool m_busy = false;        // request dispatched, response not yet sent
+    bool m_streaming = false;   // between beginResponse() and endResponse()
+    bool m_chunked = false;
+    bool m_keepAlive = false;   // keep connection open after current response
+    bool m_dispatching = false;
+    bool m_closed = false;
+
+    // Per request, reported to HttpMetrics in finishResponse()
+    int m_metricsRoute = 0;
+    int m_responseStatus = 0;
+    QElapsedTimer m_requestTimer;
+    qint64 m_headNs = -1;       // request timer when the head was written, -1 before
+};
+
+#endif // HTTPCONNECTION_H
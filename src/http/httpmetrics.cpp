@@ -0,0 +1,250 @@
+#include "httpmetrics.h"
+
+// Upper bounds of the latency buckets
+static const qint64 kBoundsNs[HttpMetrics::Histogram::kBuckets] = {
+    500000LL, 1000000LL, 2500000LL, 5000000LL, 10000000LL, 25000000LL, 50000000LL,
+    100000000LL, 250000000LL, 500000000LL, 1000000000LL, 2500000000LL, 5000000000LL, 10000000000LL
+};
+static const char *const kBoundLabels[HttpMetrics::Histogram::kBuckets] = {
+    "0.0005", "0.001", "0.0025", "0.005", "0.01", "0.025", "0.05",
+    "0.1", "0.25", "0.5", "1", "2.5", "5", "10"
+};
+static const char *const kClassLabels[] = { "none", "1xx", "2xx", "3xx", "4xx", "5xx" };
+
+/**
+ * @brief HttpMetrics::Histogram::observe
+ * @param ns
+ */
+void HttpMetrics::Histogram::observe(qint64 ns)
+{
+    ns = qMax<qint64>(0, ns);
+    int i = 0;
+    while (i < kBuckets && ns > kBoundsNs[i]) {
+        ++i;
+    }
+    m_counts[i].fetch_add(1, std::memory_order_relaxed);
+    m_sumNs.fetch_add(quint64(ns), std::memory_order_relaxed);
+}
+
+/**
+ * @brief HttpMetrics::Histogram::count
+ * @return
+ */
+quint64 HttpMetrics::Histogram::count() const
+{
+    quint64 n = 0;
+    for (const auto &c : m_counts) {
+        n += c.load(std::memory_order_relaxed);
+    }
+    return n;
+}
+
+/**
+ * @brief HttpMetrics::Histogram::append
+ * Buckets are stored per range and summed up here (Prometheus buckets are
+ * cumulative).
+ * @param out
+ * @param name
+ * @param labels
+ */
+void HttpMetrics::Histogram::append(QByteArray &out, QByteArrayView name, QByteArrayView labels) const
+{
+    const QByteArray prefix = labels.isEmpty() ? QByteArray() : labels.toByteArray() + ',';
+
+    quint64 cumulative = 0;
+    for (int i = 0; i <= kBuckets; ++i) {
+        cumulative += m_counts[i].load(std::memory_order_relaxed);
+        out.append(name);
+        out += "_bucket{" + prefix + "le=\"";
+        out += (i < kBuckets) ? kBoundLabels[i] : "+Inf";
+        out += "\"} " + QByteArray::number(cumulative) + '\n';
+    }
+
+    const QByteArray braces = labels.isEmpty() ? QByteArray() : '{' + labels.toByteArray() + '}';
+    out.append(name);
+    out += "_sum" + braces + ' ';
+    out += QByteArray::number(double(m_sumNs.load(std::memory_order_relaxed)) / 1e9, 'f', 6) + '\n';
+    out.append(name);
+    out += "_count" + braces + ' ' + QByteArray::number(cumulative) + '\n';
+}
+
+/**
+ * @brief HttpMetrics::HttpMetrics
+ */
+HttpMetrics::HttpMetrics()
+{
+    m_routes[0].label = "other";
+}
+
+/**
+ * @brief HttpMetrics::instance
+ * @return
+ */
+HttpMetrics *HttpMetrics::instance()
+{
+    static HttpMetrics metrics;
+    return &metrics;
+}
+
+/**
+ * @brief HttpMetrics::addRoute
+ * @param method
+ * @param pattern
+ * @return id for observeRequest(), 0 once the table is full
+ */
+int HttpMetrics::addRoute(QByteArrayView method, QByteArrayView pattern)
+{
+    const QByteArray label = method.toByteArray() + ' ' + pattern.toByteArray();
+    for (int i = 1; i < m_routeCount; ++i) {
+        if (m_routes[i].label == label) {
+            return i;
+        }
+    }
+    if (m_routeCount == kMaxRoutes) {
+        return 0;
+    }
+    m_routes[m_routeCount].label = label;
+    return m_routeCount++;
+}
+
+/**
+ * @brief HttpMetrics::statusClass
+ * @param status
+ * @return
+ */
+int HttpMetrics::statusClass(int status)
+{
+    const int c = status / 100;
+    return (c >= 1 && c <= 5) ? c : 0;
+}
+
+/**
+ * @brief HttpMetrics::observeRequest
+ * @param route
+ * @param status
+ * @param ns from dispatch to the response head, < 0: counted without latency
+ */
+void HttpMetrics::observeRequest(int route, int status, qint64 ns)
+{
+    RouteStats &r = m_routes[(route > 0 && route < kMaxRoutes) ? route : 0];
+    r.requests[statusClass(status)].fetch_add(1, std::memory_order_relaxed);
+    if (ns >= 0) {
+        r.latency.observe(ns);
+    }
+}
+
+/**
+ * @brief HttpMetrics::observeUpstream
+ * @param endpoint
+ * @param status
+ * @param ns from sending the call to the end of the node's reply
+ */
+void HttpMetrics::observeUpstream(Upstream endpoint, int status, qint64 ns)
+{
+    UpstreamStats &u = m_upstream[int(endpoint)];
+    const int c = statusClass(status);
+    u.requests[c].fetch_add(1, std::memory_order_relaxed);
+    u.latency[c].observe(ns);
+}
+
+/**
+ * @brief HttpMetrics::appendHeader
+ * @param out
+ * @param name
+ * @param type
+ * @param help
+ */
+void HttpMetrics::appendHeader(QByteArray &out, QByteArrayView name, QByteArrayView type, QByteArrayView help)
+{
+    out += "# HELP ";
+    out.append(name);
+    out += ' ';
+    out.append(help);
+    out += "\n# TYPE ";
+    out.append(name);
+    out += ' ';
+    out.append(type);
+    out += '\n';
+}
+
+/**
+ * @brief HttpMetrics::appendLabelValue
+ * @param out
+ * @param value
+ */
+void HttpMetrics::appendLabelValue(QByteArray &out, QByteArrayView value)
+{
+    out += '"';
+    for (char ch : value) {
+        if (ch == '\\' || ch == '"') {
+            out += '\\';
+            out += ch;
+        } else if (ch == '\n') {
+            out += "\\n";
+        } else {
+            out += ch;
+        }
+    }
+    out += '"';
+}
+
+/**
+ * @brief HttpMetrics::appendPrometheus
+ * Series without any observation are left out.
+ * @param out
+ */
+void HttpMetrics::appendPrometheus(QByteArray &out) const
+{
+    const int routes = m_routeCount;
+
+    appendHeader(out, "grin_controller_http_requests_total", "counter",
+                 "HTTP requests by route and status class.");
+    for (int i = 0; i < routes; ++i) {
+        for (int c = 0; c < kStatusClasses; ++c) {
+            const quint64 n = m_routes[i].requests[c].load(std::memory_order_relaxed);
+            if (n == 0) {
+                continue;
+            }
+            out += "grin_controller_http_requests_total{route=";
+            appendLabelValue(out, m_routes[i].label);
+            out += ",code=\"";
+            out += kClassLabels[c];
+            out += "\"} " + QByteArray::number(n) + '\n';
+        }
+    }
+
+    appendHeader(out, "grin_controller_http_request_duration_seconds", "histogram",
+                 "Time from dispatch to the end of the response, by route.");
+    for (int i = 0; i < routes; ++i) {
+        if (m_routes[i].latency.count() == 0) {
+            continue;
+        }
+        QByteArray labels("route=");
+        appendLabelValue(labels, m_routes[i].label);
+        m_routes[i].latency.append(out, "grin_controller_http_request_duration_seconds", labels);
+    }
+
+    static const char *const kEndpoints[] = { "owner", "foreign" };
+    appendHeader(out, "grin_controller_upstream_request_duration_seconds", "histogram",
+                 "Proxied node RPC calls (/v2/owner, /v2/foreign) by status class of the node's reply.");
+    for (int e = 0; e < int(Upstream::Count); ++e) {
+        for (int c = 0; c < kStatusClasses; ++c) {
+            if (m_upstream[e].latency[c].count() == 0) {
+                continue;
+            }
+            QByteArray labels("endpoint=\"");
+            labels += kEndpoints[e];
+            labels += "\",code=\"";
+            labels += kClassLabels[c];
+            labels += '"';
+            m_upstream[e].latency[c].append(out, "grin_controller_upstream_request_duration_seconds", labels);
+        }
+    }
+
+    appendHeader(out, "grin_controller_http_received_bytes_total", "counter", "Bytes read from clients.");
+    out += "grin_controller_http_received_bytes_total "
+        + QByteArray::number(m_bytesIn.load(std::memory_order_relaxed)) + '\n';
+    appendHeader(out, "grin_controller_http_sent_bytes_total", "counter", "Bytes written to clients.");
+    out += "grin_controller_http_sent_bytes_total "
+        + QByteArray::number(m_bytesOut.load(std::memory_order_relaxed)) + '\n';
+}
@@ -0,0 +1,92 @@
+#ifndef HTTPMETRICS_H
+#define HTTPMETRICS_H
+
+#include <QByteArray>
+#include <QByteArrayView>
+
+#include <atomic>
+
+/**
+ * @brief The HttpMetrics class
+ * Process-wide counters and latency histograms of the controller itself,
+ * served as Prometheus text on GET /metrics. Recording is a few relaxed
+ * atomic increments, no locks and no allocation; the scrape reads the
+ * counters without stopping the writers. Routes are registered once
+ * during setup, before any worker runs.
+ */
+class HttpMetrics
+{
+public:
+    enum class Upstream {
+        Owner,
+        Foreign,
+        Count
+    };
+
+    // Latency histogram with fixed buckets from 0.5 ms to 10 s
+    class Histogram
+    {
+    public:
+        static constexpr int kBuckets = 14;    // plus +Inf
+
+        void observe(qint64 ns);
+        quint64 count() const;
+        // _bucket, _sum and _count lines; labels without braces, may be empty
+        void append(QByteArray &out, QByteArrayView name, QByteArrayView labels) const;
+
+    private:
+        std::atomic<quint64> m_counts[kBuckets + 1] = {};
+        std::atomic<quint64> m_sumNs{ 0 };
+    };
+
+    static HttpMetrics *instance();
+
+    // Setup only; the same label returns the same id, 0 = unmatched requests
+    int addRoute(QByteArrayView method, QByteArrayView pattern);
+
+    // status 0: no response (client gone, transport error)
+    void observeRequest(int route, int status, qint64 ns);
+    void observeUpstream(Upstream endpoint, int status, qint64 ns);
+
+    void addBytesIn(qint64 n)
+    {
+        m_bytesIn.fetch_add(quint64(n), std::memory_order_relaxed);
+    }
+
+    void addBytesOut(qint64 n)
+    {
+        m_bytesOut.fetch_add(quint64(n), std::memory_order_relaxed);
+    }
+
+    void appendPrometheus(QByteArray &out) const;
+    static void appendHeader(QByteArray &out, QByteArrayView name, QByteArrayView type, QByteArrayView help);
+    static void appendLabelValue(QByteArray &out, QByteArrayView value);   // quoted and escaped
+
+private:
+    static constexpr int kMaxRoutes = 32;
+    static constexpr int kStatusClasses = 6;    // no response, 1xx .. 5xx
+
+    struct RouteStats {
+        QByteArray label;
+        std::atomic<quint64> requests[kStatusClasses] = {};
+        Histogram latency;
+    };
+
+    struct UpstreamStats {
+        std::atomic<quint64> requests[kStatusClasses] = {};
+        Histogram latency[kStatusClasses];
+    };
+
+    HttpMetrics();
+    static int statusClass(int status);
+
+    RouteStats m_routes[kMaxRoutes];
+    int m_routeCount = 1;
+    UpstreamStats m_upstream[int(Upstream::Count)];
+
+    // Written by every worker; kept apart from each other and the rest
+    alignas(64) std::atomic<quint64> m_bytesIn{ 0 };
+    alignas(64) std::atomic<quint64> m_bytesOut{ 0 };
+};
+
+#endif // HTTPMETRICS_H
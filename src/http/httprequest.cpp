@@ -0,0 +1,112 @@
+#include "httprequest.h"
+
+/**
+ * @brief HttpRequest::equalsIgnoreCase
+ * ASCII only, header names are tokens.
+ * @param a
+ * @param b
+ * @return
+ */
+bool HttpRequest::equalsIgnoreCase(QByteArrayView a, QByteArrayView b)
+{
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (qsizetype i = 0; i < a.size(); ++i) {
+        char x = a[i];
+        char y = b[i];
+        if (x >= 'A' && x <= 'Z') {
+            x = char(x + ('a' - 'A'));
+        }
+        if (y >= 'A' && y <= 'Z') {
+            y = char(y + ('a' - 'A'));
+        }
+        if (x != y) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief decodeQueryPart
+ * '+' is a space in form encoding, then percent decoding.
+ * @param part
+ * @return
+ */
+static QByteArray decodeQueryPart(QByteArrayView part)
+{
+    QByteArray out = part.toByteArray();
+    if (!out.contains('%') && !out.contains('+')) {
+        return out;
+    }
+    out.replace('+', ' ');
+    return QByteArray::fromPercentEncoding(out);
+}
+
+/**
+ * @brief HttpRequest::header
+ * @param name
+ * @return
+ */
+QByteArrayView HttpRequest::header(QByteArrayView name) const
+{
+    for (const Header &h : headers) {
+        if (equalsIgnoreCase(view(h.name), name)) {
+            return view(h.value);
+        }
+    }
+    return QByteArrayView();
+}
+
+/**
+ * @brief HttpRequest::hasHeader
+ * @param name
+ * @return
+ */
+bool HttpRequest::hasHeader(QByteArrayView name) const
+{
+    for (const Header &h : headers) {
+        if (equalsIgnoreCase(view(h.name), name)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief HttpRequest::queryItem
+ * Scans the raw query in place, only the matching value is decoded.
+ * @param key
+ * @param found
+ * @return
+ */
+QByteArray HttpRequest::queryItem(QByteArrayView key, bool *found) const
+{
+    if (found) {
+        *found = false;
+    }
+
+    const QByteArrayView q = query();
+    qsizetype start = 0;
+    while (start <= q.size()) {
+        qsizetype end = q.indexOf('&', start);
+        if (end < 0) {
+            end = q.size();
+        }
+
+        const QByteArrayView item = q.sliced(start, end - start);
+        const qsizetype eq = item.indexOf('=');
+        const QByteArrayView k = (eq >= 0) ? item.first(eq) : item;
+        const QByteArrayView v = (eq >= 0) ? item.sliced(eq + 1) : QByteArrayView();
+
+        if (!k.isEmpty() && (k == key || QByteArrayView(decodeQueryPart(k)) == key)) {
+            if (found) {
+                *found = true;
+            }
+            return decodeQueryPart(v);
+        }
+        start = end + 1;
+    }
+    return QByteArray();
+}
@@ -0,0 +1,80 @@
+#ifndef HTTPREQUEST_H
+#define HTTPREQUEST_H
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QVarLengthArray>
+#include <QString>
+
+/**
+ * @brief The HttpRequest struct
+ * One parsed HTTP request as handed from HttpConnection to the router.
+ * Method, target, headers and body are not copied out of the receive
+ * buffer: the request keeps a reference to it (raw) and stores offsets.
+ */
+struct HttpRequest {
+    struct Span {
+        int pos = 0;
+        int len = 0;
+    };
+
+    struct Header {
+        Span name;
+        Span value;
+    };
+
+    QByteArray raw;                         // receive buffer, all spans point into it
+    Span methodSpan;                        // "GET", "POST", "OPTIONS", ...
+    Span pathSpan;                          // "/start/grinpp" "/start/grinrust"
+    Span querySpan;                         // raw query without '?'
+    Span versionSpan;                       // "HTTP/1.1", empty if missing
+    Span bodySpan;                          // empty if the body is streamed
+    QVarLengthArray<Header, 16> headers;    // in request order
+
+    QByteArrayView view(const Span &s) const
+    {
+        return QByteArrayView(raw.constData() + s.pos, s.len);
+    }
+
+    QByteArrayView method() const
+    {
+        return view(methodSpan);
+    }
+
+    QByteArrayView path() const
+    {
+        return view(pathSpan);
+    }
+
+    QByteArrayView query() const
+    {
+        return view(querySpan);
+    }
+
+    QByteArrayView httpVersion() const
+    {
+        return view(versionSpan);
+    }
+
+    QByteArrayView body() const
+    {
+        return view(bodySpan);
+    }
+
+    bool isHttp10() const
+    {
+        return httpVersion() == QByteArrayView("HTTP/1.0");
+    }
+
+    // Case-insensitive lookup, empty view if missing
+    QByteArrayView header(QByteArrayView name) const;
+    bool hasHeader(QByteArrayView name) const;
+
+    // Percent-decoded value of the first matching query parameter
+    QByteArray queryItem(QByteArrayView key, bool *found = nullptr) const;
+
+    // ASCII case-insensitive compare for header names and tokens
+    static bool equalsIgnoreCase(QByteArrayView a, QByteArrayView b);
+};
+
+#endif // HTTPREQUEST_H
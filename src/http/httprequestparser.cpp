@@ -0,0 +1,336 @@
+#include "httprequestparser.h"
+
+#include <cstring>
+
+/**
+ * @brief isSpace
+ * @param c
+ * @return
+ */
+static inline bool isSpace(char c)
+{
+    return c == ' ' || c == '\t';
+}
+
+/**
+ * @brief parseDecimal
+ * Strict non-negative integer, no sign, no spaces.
+ * @param v
+ * @param out
+ * @return
+ */
+static bool parseDecimal(QByteArrayView v, qint64 &out)
+{
+    if (v.isEmpty() || v.size() > 18) {
+        return false;
+    }
+    qint64 n = 0;
+    for (qsizetype i = 0; i < v.size(); ++i) {
+        const char c = v[i];
+        if (c < '0' || c > '9') {
+            return false;
+        }
+        n = n * 10 + (c - '0');
+    }
+    out = n;
+    return true;
+}
+
+/**
+ * @brief HttpRequestParser::HttpRequestParser
+ */
+HttpRequestParser::HttpRequestParser()
+{
+}
+
+/**
+ * @brief HttpRequestParser::setLimits
+ * @param limits
+ */
+void HttpRequestParser::setLimits(const Limits &limits)
+{
+    m_limits = limits;
+}
+
+/**
+ * @brief HttpRequestParser::limits
+ * @return
+ */
+const HttpRequestParser::Limits &HttpRequestParser::limits() const
+{
+    return m_limits;
+}
+
+/**
+ * @brief HttpRequestParser::reset
+ * Prepares for the next request; the buffer must then start at it.
+ */
+void HttpRequestParser::reset()
+{
+    m_state = State::RequestLine;
+    m_lineStart = 0;
+    m_scanned = 0;
+    m_headSize = 0;
+    m_contentLength = 0;
+    m_errorStatus = 0;
+    m_errorMessage.clear();
+}
+
+/**
+ * @brief HttpRequestParser::parse
+ * @param buffer
+ * @param out spans are relative to buffer, out.raw is not touched
+ * @return
+ */
+HttpRequestParser::Result HttpRequestParser::parse(const QByteArray &buffer, HttpRequest &out)
+{
+    if (m_state == State::Done) {
+        return Result::Complete;
+    }
+    if (m_errorStatus != 0) {
+        return Result::Error;
+    }
+    if (m_state == State::RequestLine && m_lineStart == 0 && m_scanned == 0) {
+        out = HttpRequest();
+    }
+
+    const char *data = buffer.constData();
+    const int size = int(qMin<qsizetype>(buffer.size(), m_limits.maxHeadBytes + 1));
+
+    while (m_lineStart < size) {
+        const int from = m_lineStart + m_scanned;
+        const void *nl = std::memchr(data + from, '\n', size_t(size - from));
+        if (!nl) {
+            m_scanned = size - m_lineStart;
+            break;
+        }
+
+        const int lineEnd = int(static_cast<const char *>(nl) - data);
+        int end = lineEnd;
+        if (end > m_lineStart && data[end - 1] == '\r') {
+            --end;
+        }
+        const int begin = m_lineStart;
+        m_lineStart = lineEnd + 1;
+        m_scanned = 0;
+
+        if (m_state == State::RequestLine) {
+            if (end == begin) {
+                // Stray CRLF between pipelined requests
+                continue;
+            }
+            if (!parseRequestLine(data, begin, end, out)) {
+                return fail(400, QStringLiteral("bad request line"));
+            }
+            m_state = State::Headers;
+            continue;
+        }
+
+        // Headers
+        if (end == begin) {
+            m_headSize = m_lineStart;
+            if (!finishHead(data, out)) {
+                return Result::Error;
+            }
+            m_state = State::Done;
+            return Result::Complete;
+        }
+        if (!parseHeaderLine(data, begin, end, out)) {
+            return Result::Error;
+        }
+    }
+
+    if (buffer.size() > m_limits.maxHeadBytes) {
+        return fail(431, QStringLiteral("request header too large"));
+    }
+    return Result::NeedMore;
+}
+
+/**
+ * @brief HttpRequestParser::parseRequestLine
+ * "GET /status?x=1 HTTP/1.1"
+ * @return
+ */
+bool HttpRequestParser::parseRequestLine(const char *data, int begin, int end, HttpRequest &out)
+{
+    const char *line = data + begin;
+    const int len = end - begin;
+
+    const void *sp1 = std::memchr(line, ' ', size_t(len));
+    if (!sp1) {
+        return false;
+    }
+    const int methodLen = int(static_cast<const char *>(sp1) - line);
+    if (methodLen == 0) {
+        return false;
+    }
+    out.methodSpan = { begin, methodLen };
+
+    int targetBegin = methodLen + 1;
+    while (targetBegin < len && line[targetBegin] == ' ') {
+        ++targetBegin;
+    }
+    const void *sp2 = std::memchr(line + targetBegin, ' ', size_t(len - targetBegin));
+    const int targetEnd = sp2 ? int(static_cast<const char *>(sp2) - line) : len;
+    if (targetEnd == targetBegin) {
+        return false;
+    }
+
+    if (sp2) {
+        int vBegin = targetEnd + 1;
+        while (vBegin < len && line[vBegin] == ' ') {
+            ++vBegin;
+        }
+        int vEnd = len;
+        while (vEnd > vBegin && isSpace(line[vEnd - 1])) {
+            --vEnd;
+        }
+        out.versionSpan = { begin + vBegin, vEnd - vBegin };
+    }
+
+    const void *qm = std::memchr(line + targetBegin, '?', size_t(targetEnd - targetBegin));
+    if (qm) {
+        const int q = int(static_cast<const char *>(qm) - line);
+        out.pathSpan = { begin + targetBegin, q - targetBegin };
+        out.querySpan = { begin + q + 1, targetEnd - q - 1 };
+    } else {
+        out.pathSpan = { begin + targetBegin, targetEnd - targetBegin };
+    }
+    return true;
+}
+
+/**
+ * @brief HttpRequestParser::parseHeaderLine
+ * "Name: value", optional whitespace around the value is dropped.
+ * @return
+ */
+bool HttpRequestParser::parseHeaderLine(const char *data, int begin, int end, HttpRequest &out)
+{
+    const void *colonPtr = std::memchr(data + begin, ':', size_t(end - begin));
+    if (!colonPtr) {
+        // Tolerated like before: lines without ':' are skipped
+        return true;
+    }
+    const int colon = int(static_cast<const char *>(colonPtr) - data);
+
+    int nameEnd = colon;
+    while (nameEnd > begin && isSpace(data[nameEnd - 1])) {
+        --nameEnd;
+    }
+    if (nameEnd == begin) {
+        return true;
+    }
+
+    int vBegin = colon + 1;
+    while (vBegin < end && isSpace(data[vBegin])) {
+        ++vBegin;
+    }
+    int vEnd = end;
+    while (vEnd > vBegin && isSpace(data[vEnd - 1])) {
+        --vEnd;
+    }
+
+    if (out.headers.size() >= m_limits.maxHeaders) {
+        fail(431, QStringLiteral("too many request headers"));
+        return false;
+    }
+
+    HttpRequest::Header h;
+    h.name = { begin, nameEnd - begin };
+    h.value = { vBegin, vEnd - vBegin };
+    out.headers.append(h);
+    return true;
+}
+
+/**
+ * @brief HttpRequestParser::finishHead
+ * Body framing: only Content-Length is supported; repeated Content-Length
+ * headers must carry the same value.
+ * @param data
+ * @param out
+ * @return
+ */
+bool HttpRequestParser::finishHead(const char *data, const HttpRequest &out)
+{
+    m_contentLength = 0;
+    bool haveLength = false;
+
+    for (const HttpRequest::Header &h : out.headers) {
+        const QByteArrayView name(data + h.name.pos, h.name.len);
+        const QByteArrayView value(data + h.value.pos, h.value.len);
+
+        if (HttpRequest::equalsIgnoreCase(name, "content-length")) {
+            qint64 length = 0;
+            if (!parseDecimal(value, length)) {
+                fail(400, QStringLiteral("invalid content-length"));
+                return false;
+            }
+            // Repeated headers must agree, or we and the node would frame
+            // the body differently (request smuggling)
+            if (haveLength && length != m_contentLength) {
+                fail(400, QStringLiteral("conflicting content-length"));
+                return false;
+            }
+            haveLength = true;
+            m_contentLength = length;
+            if (m_contentLength > m_limits.maxBodyBytes) {
+                fail(413, QStringLiteral("request body too large"));
+                return false;
+            }
+        } else if (HttpRequest::equalsIgnoreCase(name, "transfer-encoding")
+                   && !HttpRequest::equalsIgnoreCase(value, "identity")) {
+            fail(501, QStringLiteral("transfer-encoding not supported"));
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief HttpRequestParser::fail
+ * @param status
+ * @param msg
+ * @return
+ */
+HttpRequestParser::Result HttpRequestParser::fail(int status, const QString &msg)
+{
+    m_errorStatus = status;
+    m_errorMessage = msg;
+    return Result::Error;
+}
+
+/**
+ * @brief HttpRequestParser::headSize
+ * @return bytes of request line, headers and the empty line
+ */
+int HttpRequestParser::headSize() const
+{
+    return m_headSize;
+}
+
+/**
+ * @brief HttpRequestParser::contentLength
+ * @return
+ */
+qint64 HttpRequestParser::contentLength() const
+{
+    return m_contentLength;
+}
+
+/**
+ * @brief HttpRequestParser::errorStatus
+ * @return
+ */
+int HttpRequestParser::errorStatus() const
+{
+    return m_errorStatus;
+}
+
+/**
+ * @brief HttpRequestParser::errorMessage
+ * @return
+ */
+QString HttpRequestParser::errorMessage() const
+{
+    return m_errorMessage;
+}
@@ -0,0 +1,67 @@
+#ifndef HTTPREQUESTPARSER_H
+#define HTTPREQUESTPARSER_H
+
+#include <QByteArray>
+#include <QString>
+
+#include "httprequest.h"
+
+/**
+ * @brief The HttpRequestParser class
+ * Resumable parser for the request head. Each call continues where the
+ * previous one stopped, every byte of the head is looked at once. Results
+ * are offsets into the receive buffer (HttpRequest::Span), nothing is
+ * copied or lower-cased. Enforces head, header count and body size limits.
+ */
+class HttpRequestParser
+{
+public:
+    enum class Result {
+        NeedMore,
+        Complete,   // head parsed, headSize()/contentLength() valid
+        Error       // errorStatus()/errorMessage() valid
+    };
+
+    struct Limits {
+        int maxHeadBytes = 32 * 1024;
+        int maxHeaders = 64;
+        qint64 maxBodyBytes = 16 * 1024 * 1024;
+    };
+
+    HttpRequestParser();
+
+    void setLimits(const Limits &limits);
+    const Limits &limits() const;
+
+    // buffer must start at the first byte of the request
+    Result parse(const QByteArray &buffer, HttpRequest &out);
+    void reset();
+
+    int headSize() const;
+    qint64 contentLength() const;
+    int errorStatus() const;
+    QString errorMessage() const;
+
+private:
+    enum class State {
+        RequestLine,
+        Headers,
+        Done
+    };
+
+    bool parseRequestLine(const char *data, int begin, int end, HttpRequest &out);
+    bool parseHeaderLine(const char *data, int begin, int end, HttpRequest &out);
+    bool finishHead(const char *data, const HttpRequest &out);
+    Result fail(int status, const QString &msg);
+
+    Limits m_limits;
+    State m_state = State::RequestLine;
+    int m_lineStart = 0;    // first byte of the line not processed yet
+    int m_scanned = 0;      // bytes of that line already searched for '\n'
+    int m_headSize = 0;
+    qint64 m_contentLength = 0;
+    int m_errorStatus = 0;
+    QString m_errorMessage;
+};
+
+#endif // HTTPREQUESTPARSER_H
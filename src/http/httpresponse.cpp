@@ -0,0 +1,214 @@
+#include "httpresponse.h"
+
+#include <QHash>
+
+// Statuses the controller answers with; other codes are built on demand
+static const int kPrebuiltStatuses[] = { 200, 204, 304, 400, 404, 405, 413, 431, 500, 501, 503 };
+
+static int blockKey(int statusCode, HttpResponse::ContentType type, bool defaultAllowHeaders)
+{
+    return statusCode * 8 + int(type) * 2 + (defaultAllowHeaders ? 1 : 0);
+}
+
+static QByteArray buildHead(int statusCode, HttpResponse::ContentType type, bool defaultAllowHeaders)
+{
+    QByteArray head;
+    head += HttpResponse::statusLine(statusCode);
+    if (type == HttpResponse::ContentType::Json) {
+        head += "Content-Type: application/json\r\n";
+    } else if (type == HttpResponse::ContentType::EventStream) {
+        head += "Content-Type: text/event-stream\r\n";
+        head += "Cache-Control: no-cache\r\n";
+        head += "X-Accel-Buffering: no\r\n";
+    } else if (type == HttpResponse::ContentType::Metrics) {
+        head += "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n";
+    }
+    head += "Access-Control-Allow-Origin: *\r\n";
+    head += "Access-Control-Allow-Methods: GET, POST, OPTIONS\r\n";
+    if (defaultAllowHeaders) {
+        head += "Access-Control-Allow-Headers: Content-Type, Authorization\r\n";
+    }
+    return head;
+}
+
+/**
+ * @brief HttpResponse::HttpResponse
+ * @param statusCode
+ * @param type
+ */
+HttpResponse::HttpResponse(int statusCode, ContentType type) :
+    m_statusCode(statusCode),
+    m_type(type),
+    m_prebuilt(prebuiltHead(statusCode, type))
+{
+}
+
+/**
+ * @brief HttpResponse::setContentLength
+ * @param length
+ * @return
+ */
+HttpResponse &HttpResponse::setContentLength(qint64 length)
+{
+    m_contentLength = length;
+    return *this;
+}
+
+/**
+ * @brief HttpResponse::setAllowHeaders
+ * @param allowHeaders value of Access-Control-Allow-Headers
+ * @return
+ */
+HttpResponse &HttpResponse::setAllowHeaders(QByteArrayView allowHeaders)
+{
+    m_prebuilt = prebuiltHead(m_statusCode, m_type, false);
+    return addHeader("Access-Control-Allow-Headers", allowHeaders);
+}
+
+/**
+ * @brief HttpResponse::addHeader
+ * @param name
+ * @param value
+ * @return
+ */
+HttpResponse &HttpResponse::addHeader(QByteArrayView name, QByteArrayView value)
+{
+    m_headers.reserve(m_headers.size() + name.size() + value.size() + 4);
+    m_headers.append(name);
+    m_headers.append(": ", 2);
+    m_headers.append(value);
+    m_headers.append("\r\n", 2);
+    return *this;
+}
+
+/**
+ * @brief HttpResponse::setETag
+ * Not part of headers(): the tag depends on the content coding, which
+ * HttpConnection picks when the body is written.
+ * @param etag
+ * @return
+ */
+HttpResponse &HttpResponse::setETag(QByteArrayView etag)
+{
+    m_etag = etag.toByteArray();
+    return *this;
+}
+
+/**
+ * @brief HttpResponse::statusCode
+ * @return
+ */
+int HttpResponse::statusCode() const
+{
+    return m_statusCode;
+}
+
+/**
+ * @brief HttpResponse::contentType
+ * @return
+ */
+HttpResponse::ContentType HttpResponse::contentType() const
+{
+    return m_type;
+}
+
+/**
+ * @brief HttpResponse::contentLength
+ * @return
+ */
+qint64 HttpResponse::contentLength() const
+{
+    return m_contentLength;
+}
+
+/**
+ * @brief HttpResponse::prebuilt
+ * @return
+ */
+const QByteArray &HttpResponse::prebuilt() const
+{
+    return m_prebuilt;
+}
+
+/**
+ * @brief HttpResponse::headers
+ * @return
+ */
+const QByteArray &HttpResponse::headers() const
+{
+    return m_headers;
+}
+
+/**
+ * @brief HttpResponse::etag
+ * @return quoted tag of the identity body, empty if none
+ */
+const QByteArray &HttpResponse::etag() const
+{
+    return m_etag;
+}
+
+/**
+ * @brief HttpResponse::statusLine
+ * @param code
+ * @return
+ */
+QByteArray HttpResponse::statusLine(int code)
+{
+    // Minimal mapping
+    switch (code) {
+    case 200:
+        return "HTTP/1.1 200 OK\r\n";
+    case 204:
+        return "HTTP/1.1 204 No Content\r\n";
+    case 304:
+        return "HTTP/1.1 304 Not Modified\r\n";
+    case 400:
+        return "HTTP/1.1 400 Bad Request\r\n";
+    case 404:
+        return "HTTP/1.1 404 Not Found\r\n";
+    case 405:
+        return "HTTP/1.1 405 Method Not Allowed\r\n";
+    case 413:
+        return "HTTP/1.1 413 Payload Too Large\r\n";
+    case 431:
+        return "HTTP/1.1 431 Request Header Fields Too Large\r\n";
+    case 500:
+        return "HTTP/1.1 500 Internal Server Error\r\n";
+    case 501:
+        return "HTTP/1.1 501 Not Implemented\r\n";
+    case 503:
+        return "HTTP/1.1 503 Service Unavailable\r\n";
+    default:
+        return QByteArray("HTTP/1.1 ") + QByteArray::number(code) + " OK\r\n";
+    }
+}
+
+/**
+ * @brief HttpResponse::prebuiltHead
+ * Status line, Content-Type and CORS headers. Known statuses are built once
+ * (thread-safe static init) and returned as shared copies.
+ * @param statusCode
+ * @param type
+ * @param defaultAllowHeaders include the default Access-Control-Allow-Headers
+ * @return
+ */
+QByteArray HttpResponse::prebuiltHead(int statusCode, ContentType type, bool defaultAllowHeaders)
+{
+    static const QHash<int, QByteArray> blocks = [] {
+        QHash<int, QByteArray> b;
+        for (int code : kPrebuiltStatuses) {
+            for (ContentType t : { ContentType::None, ContentType::Json, ContentType::EventStream, ContentType::Metrics }) {
+                b.insert(blockKey(code, t, true), buildHead(code, t, true));
+                b.insert(blockKey(code, t, false), buildHead(code, t, false));
+            }
+        }
+        return b;
+    }();
+
+    const auto it = blocks.constFind(blockKey(statusCode, type, defaultAllowHeaders));
+    if (it != blocks.cend()) {
+        return it.value();
+    }
+    return buildHead(statusCode, type, defaultAllowHeaders);
+}
@@ -0,0 +1,51 @@
+#ifndef HTTPRESPONSE_H
+#define HTTPRESPONSE_H
+
+#include <QByteArray>
+#include <QByteArrayView>
+
+/**
+ * @brief The HttpResponse class
+ * Response head of the controller API. Status line, Content-Type and the
+ * CORS headers come from immutable blocks built once per status and
+ * content type and are shared, not copied. Only headers that differ per
+ * response are formatted here. Connection headers and the empty line are
+ * added by HttpConnection, which writes head and body as separate buffers.
+ */
+class HttpResponse
+{
+public:
+    enum class ContentType {
+        None,   // no body, e.g. 204 preflight
+        Json,
+        EventStream, // Server-Sent Events, never compressed
+        Metrics     // Prometheus text exposition format
+    };
+
+    explicit HttpResponse(int statusCode, ContentType type = ContentType::Json);
+
+    HttpResponse &setContentLength(qint64 length);
+    HttpResponse &setAllowHeaders(QByteArrayView allowHeaders); // replaces the default CORS list
+    HttpResponse &addHeader(QByteArrayView name, QByteArrayView value);
+    HttpResponse &setETag(QByteArrayView etag);   // quoted, content coding is added by HttpConnection
+
+    int statusCode() const;
+    ContentType contentType() const;
+    qint64 contentLength() const;           // -1 if not set
+    const QByteArray &prebuilt() const;     // shared block
+    const QByteArray &headers() const;      // per-response header lines
+    const QByteArray &etag() const;
+
+    static QByteArray statusLine(int code);
+    static QByteArray prebuiltHead(int statusCode, ContentType type, bool defaultAllowHeaders = true);
+
+private:
+    int m_statusCode;
+    ContentType m_type;
+    qint64 m_contentLength = -1;
+    QByteArray m_prebuilt;
+    QByteArray m_headers;
+    QByteArray m_etag;
+};
+
+#endif // HTTPRESPONSE_H
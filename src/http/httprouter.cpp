@@ -0,0 +1,128 @@
+#include "httprouter.h"
+
+/**
+ * @brief HttpRouter::HttpRouter
+ */
+HttpRouter::HttpRouter() :
+    m_root(new Node)
+{
+}
+
+/**
+ * @brief HttpRouter::~HttpRouter
+ */
+HttpRouter::~HttpRouter() = default;
+
+/**
+ * @brief HttpRouter::add
+ * @param method
+ * @param pattern
+ * @param handler
+ */
+void HttpRouter::add(const QByteArray &method, const QByteArray &pattern, const Handler &handler)
+{
+    Node *node = m_root.get();
+
+    const QList<QByteArray> segments = pattern.split('/');
+    for (const QByteArray &seg : segments) {
+        if (seg.isEmpty()) {
+            continue;
+        }
+
+        if (seg.startsWith('{') && seg.endsWith('}')) {
+            if (!node->param) {
+                node->param.reset(new Node);
+            }
+            node = node->param.get();
+            continue;
+        }
+
+        Node *next = nullptr;
+        for (const auto &child : node->children) {
+            if (child->segment == seg) {
+                next = child.get();
+                break;
+            }
+        }
+        if (!next) {
+            node->children.emplace_back(new Node);
+            next = node->children.back().get();
+            next->segment = seg;
+        }
+        node = next;
+    }
+
+    for (Route &route : node->routes) {
+        if (route.method == method) {
+            route.handler = handler;
+            return;
+        }
+    }
+    node->routes.push_back(Route{ method, handler });
+}
+
+/**
+ * @brief HttpRouter::match
+ * @param method
+ * @param path normalized, starting with '/', no trailing slash
+ * @param handler
+ * @param params views into path
+ * @param allow methods of the path if the method does not match
+ * @return
+ */
+HttpRouter::Match HttpRouter::match(QByteArrayView method, QByteArrayView path, const Handler **handler,
+                                    Params &params, QByteArray *allow) const
+{
+    if (path.isEmpty() || path[0] != '/') {
+        return Match::NotFound;
+    }
+
+    const Node *node = m_root.get();
+    qsizetype pos = 1;
+    while (pos < path.size()) {
+        qsizetype end = path.indexOf('/', pos);
+        if (end < 0) {
+            end = path.size();
+        }
+        const QByteArrayView seg = path.sliced(pos, end - pos);
+
+        const Node *next = nullptr;
+        for (const auto &child : node->children) {
+            if (QByteArrayView(child->segment) == seg) {
+                next = child.get();
+                break;
+            }
+        }
+        if (!next && node->param && !seg.isEmpty()) {
+            params.append(seg);
+            next = node->param.get();
+        }
+        if (!next) {
+            return Match::NotFound;
+        }
+
+        node = next;
+        pos = end + 1;
+    }
+
+    if (node->routes.empty()) {
+        return Match::NotFound;
+    }
+
+    for (const Route &route : node->routes) {
+        if (QByteArrayView(route.method) == method) {
+            *handler = &route.handler;
+            return Match::Found;
+        }
+    }
+
+    if (allow) {
+        allow->clear();
+        for (const Route &route : node->routes) {
+            *allow += route.method;
+            *allow += ", ";
+        }
+        *allow += "OPTIONS";
+    }
+    return Match::MethodNotAllowed;
+}
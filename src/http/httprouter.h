@@ -0,0 +1,61 @@
+#ifndef HTTPROUTER_H
+#define HTTPROUTER_H
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QVarLengthArray>
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "httprequest.h"
+
+class HttpConnection;
+
+/**
+ * @brief The HttpRouter class
+ * Route table built once at startup: a trie keyed by path segment, each
+ * node holding the handlers per method. Lookup walks the request path
+ * segment by segment without allocating; "{name}" segments are returned
+ * as views into the request. Literal segments win over parameters, there
+ * is no backtracking. Read-only (and thus thread-safe) after setup.
+ */
+class HttpRouter
+{
+public:
+    using Params = QVarLengthArray<QByteArrayView, 4>;
+    using Handler = std::function<void(HttpConnection *c, const HttpRequest &r, const Params &params)>;
+
+    enum class Match {
+        Found,
+        MethodNotAllowed,   // path known, allow lists its methods
+        NotFound
+    };
+
+    HttpRouter();
+    ~HttpRouter();
+
+    // pattern like "/logs/{id}"
+    void add(const QByteArray &method, const QByteArray &pattern, const Handler &handler);
+
+    Match match(QByteArrayView method, QByteArrayView path, const Handler **handler,
+                Params &params, QByteArray *allow = nullptr) const;
+
+private:
+    struct Route {
+        QByteArray method;
+        Handler handler;
+    };
+
+    struct Node {
+        QByteArray segment;                             // literal segment
+        std::vector<std::unique_ptr<Node>> children;    // literal children
+        std::unique_ptr<Node> param;                    // "{name}" child
+        std::vector<Route> routes;
+    };
+
+    std::unique_ptr<Node> m_root;
+};
+
+#endif // HTTPROUTER_H
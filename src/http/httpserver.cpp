@@ -1,27 +1,37 @@
 #include "httpserver.h"
 
+#include <QDateTime>
+#include <QHash>
+#include <QRandomGenerator>
+
+#include <limits>
+
+// /logs/{id}?since=: lines per call without / with explicit limit
+static const int kDefaultLogLimit = 1000;
+static const int kMaxLogLimit = 10000;
+// Upper bound for ?wait= on /status and /logs/{id}
+static const int kMaxWaitMs = 60000;
+
 /**
- * @brief httpStatusLine
- * @param code
+ * @brief parseTimeParam
+ * @param value epoch milliseconds, epoch seconds (below 1e11) or an ISO date
+ * @param ms
  * @return
  */
-static inline QByteArray httpStatusLine(int code)
+static bool parseTimeParam(const QByteArray &value, qint64 *ms)
 {
-    // Minimal mapping
-    switch (code) {
-    case 200:
-        return "HTTP/1.1 200 OK\r\n";
-    case 204:
-        return "HTTP/1.1 204 No Content\r\n";
-    case 400:
-        return "HTTP/1.1 400 Bad Request\r\n";
-    case 404:
-        return "HTTP/1.1 404 Not Found\r\n";
-    case 500:
-        return "HTTP/1.1 500 Internal Server Error\r\n";
-    default:
-        return QByteArray("HTTP/1.1 ") + QByteArray::number(code) + " OK\r\n";
+    bool ok = false;
+    const qint64 v = value.toLongLong(&ok);
+    if (ok) {
+        *ms = (v >= 0 && v < 100000000000LL) ? v * 1000 : v;
+        return true;
     }
+    const QDateTime dt = QDateTime::fromString(QString::fromLatin1(value), Qt::ISODateWithMs);
+    if (!dt.isValid()) {
+        return false;
+    }
+    *ms = dt.toMSecsSinceEpoch();
+    return true;
 }
 
 /**
@@ -30,9 +40,24 @@ static inline QByteArray httpStatusLine(int code)
  */
 HttpServer::HttpServer(QObject *parent) :
     QObject(parent),
-    m_nodeRpcPort(3413)
+    m_server(this),
+    m_nodeRpcPort(3413),
+    m_workerCount(0),
+    m_upstreamMaxConcurrent(8),
+    m_upstreamMaxQueue(64),
+    m_upstreamQueueTimeoutMs(5000)
 {
-    connect(&m_server, &QTcpServer::newConnection, this, &HttpServer::onNewConnection);
+    setupRoutes();
+}
+
+/**
+ * @brief HttpServer::~HttpServer
+ */
+HttpServer::~HttpServer()
+{
+    m_server.close();
+    stopWorkers();
+    qDeleteAll(m_pools);
 }
 
 /**
@@ -45,6 +70,7 @@ void HttpServer::registerNode(INodeController *node)
         return;
     }
     m_nodes.insert(node->id(), node);
+    m_logStreams.addNode(node);
 }
 
 /**
@@ -55,173 +81,352 @@ void HttpServer::registerNode(INodeController *node)
  */
 bool HttpServer::listen(quint16 port, const QHostAddress &addr)
 {
+    if (m_pools.isEmpty()) {
+        for (auto it = m_nodes.cbegin(); it != m_nodes.cend(); ++it) {
+            m_pools.insert(it.key(), new UpstreamPool(it.key(), m_upstreamMaxConcurrent,
+                                                      m_upstreamMaxQueue, m_upstreamQueueTimeoutMs));
+        }
+    }
+    if (m_workers.isEmpty()) {
+        startWorkers();
+    }
     return m_server.listen(addr, port);
 }
 
 /**
- * @brief HttpServer::onNewConnection
+ * @brief HttpServer::setWorkerCount
+ * @param count
  */
-void HttpServer::onNewConnection()
+void HttpServer::setWorkerCount(int count)
 {
-    while (QTcpSocket *s = m_server.nextPendingConnection()) {
-        s->setParent(this);
+    m_workerCount = qMax(0, count);
+}
 
-        Request r;
-        bool ok = readHttpRequest(s, r);
+/**
+ * @brief HttpServer::workerCount
+ * @return
+ */
+int HttpServer::workerCount() const
+{
+    return m_workers.isEmpty() ? m_workerCount : int(m_workers.size());
+}
 
-        if (!ok) {
-            writeBadRequest(s);
-            s->disconnectFromHost();
-            continue;
+/**
+ * @brief HttpServer::setUpstreamLimits
+ * @param maxConcurrent calls in flight per node
+ * @param maxQueue waiting calls per node before 503
+ * @param queueTimeoutMs max. wait in the queue before 503
+ */
+void HttpServer::setUpstreamLimits(int maxConcurrent, int maxQueue, int queueTimeoutMs)
+{
+    m_upstreamMaxConcurrent = maxConcurrent;
+    m_upstreamMaxQueue = maxQueue;
+    m_upstreamQueueTimeoutMs = queueTimeoutMs;
+}
+
+/**
+ * @brief HttpServer::setCompression
+ * @param minBytes bodies below this are sent raw, < 0 disables compression
+ * @param level zlib level 1..9
+ * @param streams also compress streamed (proxied) responses
+ */
+void HttpServer::setCompression(int minBytes, int level, bool streams)
+{
+    m_compression.minBytes = minBytes;
+    m_compression.level = qBound(1, level, 9);
+    m_compression.streams = streams;
+}
+
+/**
+ * @brief HttpServer::setLogBudget
+ * @param totalBytes
+ */
+void HttpServer::setLogBudget(qint64 totalBytes)
+{
+    m_logBudget = qMax<qint64>(0, totalBytes);
+}
+
+/**
+ * @brief HttpServer::startWorkers
+ */
+void HttpServer::startWorkers()
+{
+    const int count = (m_workerCount > 0) ? m_workerCount : qMax(1, QThread::idealThreadCount());
+
+    for (int i = 0; i < count; ++i) {
+        auto *t = new QThread(this);
+        t->setObjectName(QStringLiteral("http-worker-%1").arg(i));
+
+        auto *w = new HttpWorker(this, m_compression);
+        w->moveToThread(t);
+        connect(t, &QThread::finished, w, &QObject::deleteLater);
+
+        t->start();
+        m_threads << t;
+        m_workers << w;
+    }
+}
+
+/**
+ * @brief HttpServer::stopWorkers
+ */
+void HttpServer::stopWorkers()
+{
+    for (QThread *t : std::as_const(m_threads)) {
+        t->quit();
+    }
+    for (QThread *t : std::as_const(m_threads)) {
+        t->wait();
+    }
+    m_threads.clear();
+    m_workers.clear();
+}
+
+/**
+ * @brief HttpServer::Listener::incomingConnection
+ * @param socketDescriptor
+ */
+void HttpServer::Listener::incomingConnection(qintptr socketDescriptor)
+{
+    m_owner->dispatchConnection(socketDescriptor);
+}
+
+/**
+ * @brief HttpServer::dispatchConnection
+ * Hands the socket to the worker with the fewest open connections. The
+ * count is taken here, not when the worker adopts the socket: one accept
+ * notification delivers a whole burst before any worker runs.
+ * @param socketDescriptor
+ */
+void HttpServer::dispatchConnection(qintptr socketDescriptor)
+{
+    HttpWorker *target = m_workers.first();
+    for (HttpWorker *w : std::as_const(m_workers)) {
+        if (w->connectionCount() < target->connectionCount()) {
+            target = w;
         }
-        routeRequest(s, r);
-        s->disconnectFromHost();
     }
+    target->reserveConnection();
+
+    QMetaObject::invokeMethod(target, [target, socketDescriptor] {
+        target->addConnection(socketDescriptor);
+    }, Qt::QueuedConnection);
 }
 
 /**
- * @brief HttpServer::routeRequest
- * @param s
+ * @brief HttpServer::handleRequest
+ * @param c
  * @param r
  */
-void HttpServer::routeRequest(QTcpSocket *s, const Request &r)
+void HttpServer::handleRequest(HttpConnection *c, const HttpRequest &r)
 {
-    // CORS preflight
-    if (r.method == "OPTIONS") {
-        handleOptions(s, r);
-        return;
-    }
+    routeRequest(c, r);
+}
 
-    // normalize path (without trailing slash, root)
-    QByteArray path = r.path;
+/**
+ * @brief HttpServer::streamsRequestBody
+ * Proxied JSON-RPC bodies are forwarded while they arrive.
+ * @param r
+ * @return
+ */
+bool HttpServer::streamsRequestBody(const HttpRequest &r) const
+{
+    if (r.method() != "POST") {
+        return false;
+    }
+    QByteArrayView path = r.path();
     if (path.size() > 1 && path.endsWith('/')) {
         path.chop(1);
     }
+    return path == "/v2/owner" || path == "/v2/foreign";
+}
 
-    if (r.method == "GET" && path == "/status") {
-        handleStatus(s);
-        return;
-    }
+/**
+ * @brief HttpServer::rejectRequest
+ * @param c
+ * @param statusCode
+ * @param msg
+ */
+void HttpServer::rejectRequest(HttpConnection *c, int statusCode, const QString &msg)
+{
+    writeJson(c, statusCode, QJsonObject{{"error", msg}});
+}
 
-    ///start/{id} (POST)
-    if (r.method == "POST" && path.startsWith("/start/")) {
-        Request r2 = r;
-        r2.idParam = QString::fromUtf8(path.mid(sizeof("/start/") - 1));
-        handleStart(s, r2);
+/**
+ * @brief HttpServer::routeRequest
+ * @param c
+ * @param r
+ */
+void HttpServer::routeRequest(HttpConnection *c, const Request &r)
+{
+    // CORS preflight
+    if (r.method() == "OPTIONS") {
+        c->setMetricsRoute(m_optionsMetricsRoute);
+        handleOptions(c, r);
         return;
     }
 
-    ///stop/{id} (POST)
-    if (r.method == "POST" && path.startsWith("/stop/")) {
-        Request r2 = r;
-        r2.idParam = QString::fromUtf8(path.mid(sizeof("/stop/") - 1));
-        handleStop(s, r2);
-        return;
+    // normalize path (without trailing slash, root)
+    QByteArrayView path = r.path();
+    if (path.size() > 1 && path.endsWith('/')) {
+        path.chop(1);
     }
 
-    ///restart/{id} (POST)
-    if (r.method == "POST" && path.startsWith("/restart/")) {
-        Request r2 = r;
-        r2.idParam = QString::fromUtf8(path.mid(sizeof("/restart/") - 1));
-        handleRestart(s, r2);
+    HttpRouter::Params params;
+    const HttpRouter::Handler *handler = nullptr;
+    QByteArray allow;
+    switch (m_router.match(r.method(), path, &handler, params, &allow)) {
+    case HttpRouter::Match::Found:
+        (*handler)(c, r, params);
         return;
-    }
-
-    ///logs/{id} (GET)
-    if (r.method == "GET" && path.startsWith("/logs/")) {
-        Request r2 = r;
-        r2.idParam = QString::fromUtf8(path.mid(sizeof("/logs/") - 1));
-        handleLogs(s, r2);
+    case HttpRouter::Match::MethodNotAllowed:
+        writeMethodNotAllowed(c, allow);
         return;
+    case HttpRouter::Match::NotFound:
+        break;
     }
 
-    if (r.method == "POST" && path == "/v2/owner") {
-        handleOwnerProxy(s, r);
-        return;
-    }
-    if (r.method == "POST" && path == "/v2/foreign") {
-        handleForeignProxy(s, r);
-        return;
-    }
+    writeNotFound(c);
+}
 
-    ///delete/{id} (POST)  -> z.B. /delete/rust oder /delete/grinpp
-    if (r.method == "POST" && path.startsWith("/delete/")) {
-        Request r2 = r;
-        r2.idParam = QString::fromUtf8(path.mid(sizeof("/delete/") - 1));
-        handleDelete(s, r2);
-        return;
-    }
+/**
+ * @brief HttpServer::setupRoutes
+ * Builds the route table once, before any worker runs.
+ */
+void HttpServer::setupRoutes()
+{
+    using Params = HttpRouter::Params;
+
+    m_optionsMetricsRoute = HttpMetrics::instance()->addRoute("OPTIONS", "*");
+
+    addRoute("GET", "/status", [this](HttpConnection *c, const Request &r, const Params &) {
+        handleStatus(c, r, waitDeadline(r));
+    });
+    addRoute("POST", "/start/{id}", [this](HttpConnection *c, const Request &r, const Params &p) {
+        handleStart(c, r, p[0]);
+    });
+    addRoute("POST", "/stop/{id}", [this](HttpConnection *c, const Request &, const Params &p) {
+        handleStop(c, p[0]);
+    });
+    addRoute("POST", "/restart/{id}", [this](HttpConnection *c, const Request &r, const Params &p) {
+        handleRestart(c, r, p[0]);
+    });
+    addRoute("GET", "/logs/{id}", [this](HttpConnection *c, const Request &r, const Params &p) {
+        handleLogs(c, r, p[0], waitDeadline(r));
+    });
+    addRoute("GET", "/logs/{id}/stream", [this](HttpConnection *c, const Request &r, const Params &p) {
+        handleLogStream(c, r, p[0]);
+    });
+    addRoute("POST", "/logs/{id}/capacity", [this](HttpConnection *c, const Request &r, const Params &p) {
+        handleLogCapacity(c, r, p[0]);
+    });
+    addRoute("POST", "/logs/capacity", [this](HttpConnection *c, const Request &r, const Params &) {
+        handleLogCapacity(c, r, QByteArrayView());
+    });
+    addRoute("POST", "/v2/owner", [this](HttpConnection *c, const Request &r, const Params &) {
+        handleOwnerProxy(c, r);
+    });
+    addRoute("POST", "/v2/foreign", [this](HttpConnection *c, const Request &r, const Params &) {
+        handleForeignProxy(c, r);
+    });
+    addRoute("GET", "/metrics", [this](HttpConnection *c, const Request &, const Params &) {
+        handleMetrics(c);
+    });
+    addRoute("GET", "/metrics/{id}", [this](HttpConnection *c, const Request &r, const Params &p) {
+        handleNodeMetrics(c, r, p[0]);
+    });
+    // z.B. /delete/rust oder /delete/grinpp
+    addRoute("POST", "/delete/{id}", [this](HttpConnection *c, const Request &, const Params &p) {
+        handleDelete(c, p[0]);
+    });
+}
 
-    writeNotFound(s);
+/**
+ * @brief HttpServer::addRoute
+ * Registers the route with the router and, under "METHOD pattern", with
+ * HttpMetrics; the handler tags the connection before it runs.
+ * @param method
+ * @param pattern
+ * @param handler
+ */
+void HttpServer::addRoute(const QByteArray &method, const QByteArray &pattern, const HttpRouter::Handler &handler)
+{
+    const int metricsRoute = HttpMetrics::instance()->addRoute(method, pattern);
+    m_router.add(method, pattern, [metricsRoute, handler](HttpConnection *c, const Request &r,
+                                                          const HttpRouter::Params &p) {
+        c->setMetricsRoute(metricsRoute);
+        handler(c, r, p);
+    });
 }
 
-void HttpServer::handleDelete(QTcpSocket *s, const Request &r)
+void HttpServer::handleDelete(HttpConnection *c, QByteArrayView nodeId)
 {
     // Find the node by id, e.g. "rust" or "grinpp"
-    INodeController *n = nodeForId(r.idParam);
+    INodeController *n = nodeForId(nodeId);
     if (!n) {
-        writeNotFound(s, "unknown id");
-        return;
-    }
-
-    // Try to stop the node first (best effort)
-    QJsonObject stBefore = n->statusJson();
-    if (stBefore.value(QStringLiteral("running")).toBool()) {
-        // We ignore the return value here, because we want to attempt
-        // deletion of the data directory even if stopping fails.
-        n->stop();
-    }
-
-    const QString dir = n->dataDir();
-    if (dir.isEmpty()) {
-        // Without a dataDir, we consider this a server-side configuration error.
-        writeServerError(s, "dataDir is empty");
+        writeNotFound(c, "unknown id");
         return;
     }
 
-    QDir d(dir);
-    const QString absDir = d.absolutePath();
-
-    // Try to remove the directory recursively.
-    // removeOk reflects whether our recursive loop had any immediate failures.
-    const bool removeOk = removeDirRecursively(absDir);
+    const QString id = n->id();
+    callOnNode(c, n, [n, id](bool &ok) {
+        // Try to stop the node first (best effort)
+        if (n->isRunning()) {
+            // We ignore the return value here, because we want to attempt
+            // deletion of the data directory even if stopping fails.
+            n->stop();
+        }
 
-    // After the attempt, check if the directory still contains any entries.
-    // This works auch dann korrekt, wenn absDir ein Docker-Mountpoint ist:
-    // der Mountpoint bleibt als Verzeichnis bestehen, aber die Inhalte
-    // (Dateien/Unterordner) sind dann weg.
-    QDir checkDir(absDir);
-    bool hasEntries = false;
+        const QString dir = n->dataDir();
+        if (dir.isEmpty()) {
+            // Without a dataDir, we consider this a server-side configuration error.
+            ok = false;
+            return QJsonObject{{"error", "dataDir is empty"}};
+        }
 
-    if (checkDir.exists()) {
-        QFileInfoList remaining = checkDir.entryInfoList(
-            QDir::NoDotAndDotDot | QDir::AllEntries
-            );
-        hasEntries = !remaining.isEmpty();
-    }
+        QDir d(dir);
+        const QString absDir = d.absolutePath();
+
+        // Try to remove the directory recursively.
+        // removeOk reflects whether our recursive loop had any immediate failures.
+        const bool removeOk = removeDirRecursively(absDir);
+
+        // After the attempt, check if the directory still contains any entries.
+        // This works auch dann korrekt, wenn absDir ein Docker-Mountpoint ist:
+        // der Mountpoint bleibt als Verzeichnis bestehen, aber die Inhalte
+        // (Dateien/Unterordner) sind dann weg.
+        QDir checkDir(absDir);
+        bool hasEntries = false;
+
+        if (checkDir.exists()) {
+            QFileInfoList remaining = checkDir.entryInfoList(
+                QDir::NoDotAndDotDot | QDir::AllEntries
+                );
+            hasEntries = !remaining.isEmpty();
+        }
 
-    const bool finalOk = !hasEntries;
+        const bool finalOk = !hasEntries;
 
 
-    if (!removeOk && finalOk) {
-        // We got a failure somewhere in the recursion, but the directory
-        // no longer exists. This usually means something like:
-        // - partial failure on a non-critical file, or
-        // - the directory was already mostly gone.
-        // We log a warning but treat it as success for the HTTP client.
-        qWarning() << "[delete]" << absDir
-                   << "reported failure from removeDirRecursively, but path no longer exists.";
-    }
-
-    QJsonObject out{
-        { "id", r.idParam },
-        { "dataDir", absDir },
-        { "ok", finalOk }
-    };
+        if (!removeOk && finalOk) {
+            // We got a failure somewhere in the recursion, but the directory
+            // no longer exists. This usually means something like:
+            // - partial failure on a non-critical file, or
+            // - the directory was already mostly gone.
+            // We log a warning but treat it as success for the HTTP client.
+            qWarning() << "[delete]" << absDir
+                       << "reported failure from removeDirRecursively, but path no longer exists.";
+        }
 
-    // If the directory is gone, respond with 200 so the client can treat it as success.
-    // Only send 500 if the directory still exists.
-    writeJson(s, finalOk ? 200 : 500, out);
+        // If the directory is gone, respond with 200 so the client can treat it as success.
+        // Only send 500 if the directory still exists.
+        ok = finalOk;
+        return QJsonObject{
+            { "id", id },
+            { "dataDir", absDir },
+            { "ok", finalOk }
+        };
+    });
 }
 
 bool HttpServer::removeDirRecursively(const QString &path)
@@ -284,15 +489,15 @@ bool HttpServer::removeDirRecursively(const QString &path)
     return true;
 }
 
-void HttpServer::handleOptions(QTcpSocket *s, const Request &r)
+void HttpServer::handleOptions(HttpConnection *c, const Request &r)
 {
     // Default, falls der Browser keine Access-Control-Request-Headers schickt
     QByteArray allowHeaders("Content-Type, Authorization");
 
     // Access-Control-Request-Headers vom Browser auslesen
-    auto it = r.headers.constFind("access-control-request-headers");
-    if (it != r.headers.cend() && !it.value().isEmpty()) {
-        allowHeaders = it.value();  // z.B. "content-type,user-agent"
+    const QByteArrayView requested = r.header("access-control-request-headers");
+    if (!requested.isEmpty()) {
+        allowHeaders = requested.toByteArray();  // z.B. "content-type,user-agent"
 
         // Case-insensitive prüfen, ob "authorization" schon drin ist
         QByteArray lower = allowHeaders.toLower();
@@ -304,41 +509,68 @@ void HttpServer::handleOptions(QTcpSocket *s, const Request &r)
         }
     }
 
-    writeNoContentCors(s, allowHeaders);
+    writeNoContentCors(c, allowHeaders);
 }
 
 /**
  * @brief HttpServer::handleStatus
- * @param s
+ * Answers If-None-Match with 304 before anything is serialized; with
+ * ?wait=<ms> an unchanged status is held until a node reports a change.
+ * @param c
+ * @param r
+ * @param deadline end of the long-poll, expired if none
  */
-void HttpServer::handleStatus(QTcpSocket *s)
+void HttpServer::handleStatus(HttpConnection *c, const Request &r, const QDeadlineTimer &deadline)
 {
-    QJsonObject root;
-    QJsonObject nodes;
+    const QByteArray etag = statusETag();
+    QByteArray clientTag;
+    if (matchesETag(r, etag, &clientTag)) {
+        if (!deadline.hasExpired()) {
+            LongPoll::start(c, m_nodes.values(), LongPoll::Watch::Status, deadline, [this, c, r, deadline] {
+                handleStatus(c, r, deadline);
+            });
+            return;
+        }
+        writeNotModified(c, clientTag);
+        return;
+    }
+
+    // Node snapshots come pre-serialized, so they are spliced in as bytes
+    QByteArray payload;
+    payload.reserve(1024 * (m_nodes.size() + 1));
+    payload += "{\"nodes\":{";
+    bool first = true;
     for (auto it = m_nodes.cbegin(); it != m_nodes.cend(); ++it) {
-        nodes[it.key()] = it.value()->statusJson();
+        if (!first) {
+            payload += ',';
+        }
+        first = false;
+        payload += '"' + it.key().toUtf8() + "\":";
+        payload += it.value()->statusBytes();
     }
-    root["nodes"] = nodes;
-    writeJson(s, 200, root);
+    payload += "}}";
+
+    writeJsonRaw(c, 200, payload, etag);
 }
 
 /**
  * @brief HttpServer::handleStart
- * @param s
+ * @param c
  * @param r
+ * @param nodeId
  */
-void HttpServer::handleStart(QTcpSocket *s, const Request &r)
+void HttpServer::handleStart(HttpConnection *c, const Request &r, QByteArrayView nodeId)
 {
     // get correct node
-    auto *n = nodeForId(r.idParam);
+    auto *n = nodeForId(nodeId);
     if (!n) {
-        writeNotFound(s, "unknown id");
+        writeNotFound(c, "unknown id");
         return;
     }
 
     QStringList extra;
     bool okJson = false;
-    const QJsonObject obj = parseJsonObject(r.body, &okJson);
+    const QJsonObject obj = parseJsonObject(r.body(), &okJson);
     if (okJson) {
         const auto a = obj.value(QStringLiteral("args"));
         if (a.isArray()) {
@@ -350,47 +582,49 @@ void HttpServer::handleStart(QTcpSocket *s, const Request &r)
         }
     }
 
-    const bool ok = n->start(extra);
-
-    qDebug() << "ok: " << ok;
-    QJsonObject out{{"ok", ok}, {"status", n->statusJson()} };
-    writeJson(s, ok ? 200 : 500, out);
+    callOnNode(c, n, [n, extra](bool &ok) {
+        ok = n->start(extra);
+        qDebug() << "ok: " << ok;
+        return QJsonObject{{"ok", ok}, {"status", n->statusJson()} };
+    });
 }
 
 /**
  * @brief HttpServer::handleStop
- * @param s
- * @param r
+ * @param c
+ * @param nodeId
  */
-void HttpServer::handleStop(QTcpSocket *s, const Request &r)
+void HttpServer::handleStop(HttpConnection *c, QByteArrayView nodeId)
 {
-    auto *n = nodeForId(r.idParam);
+    auto *n = nodeForId(nodeId);
     if (!n) {
-        writeNotFound(s, "unknown id");
+        writeNotFound(c, "unknown id");
         return;
     }
 
-    const bool ok = n->stop();
-    QJsonObject out{{"ok", ok}, {"status", n->statusJson()} };
-    writeJson(s, ok ? 200 : 500, out);
+    callOnNode(c, n, [n](bool &ok) {
+        ok = n->stop();
+        return QJsonObject{{"ok", ok}, {"status", n->statusJson()} };
+    });
 }
 
 /**
  * @brief HttpServer::handleRestart
- * @param s
+ * @param c
  * @param r
+ * @param nodeId
  */
-void HttpServer::handleRestart(QTcpSocket *s, const Request &r)
+void HttpServer::handleRestart(HttpConnection *c, const Request &r, QByteArrayView nodeId)
 {
-    auto *n = nodeForId(r.idParam);
+    auto *n = nodeForId(nodeId);
     if (!n) {
-        writeNotFound(s, "unknown id");
+        writeNotFound(c, "unknown id");
         return;
     }
 
     QStringList extra;
     bool okJson = false;
-    const QJsonObject obj = parseJsonObject(r.body, &okJson);
+    const QJsonObject obj = parseJsonObject(r.body(), &okJson);
     if (okJson) {
         const auto a = obj.value(QStringLiteral("args"));
         if (a.isArray()) {
@@ -402,40 +636,592 @@ void HttpServer::handleRestart(QTcpSocket *s, const Request &r)
         }
     }
 
-    const bool ok = n->restart(4000, extra);
-    QJsonObject out{{"ok", ok}, {"status", n->statusJson()} };
-    writeJson(s, ok ? 200 : 500, out);
+    callOnNode(c, n, [n, extra](bool &ok) {
+        ok = n->restart(4000, extra);
+        return QJsonObject{{"ok", ok}, {"status", n->statusJson()} };
+    });
 }
 
 /**
  * @brief HttpServer::handleLogs
- * @param s
+ * Tail: ?n=<lines> (default 200). Incremental: ?since=<seq>&limit=<lines>
+ * returns the lines after the cursor. Both answer with the seq of the
+ * first returned line, the cursor for the next call ("next") and whether
+ * lines after the cursor were already dropped from the ring ("dropped").
+ * Filters: level=warn (warn and more severe) or level=error,info (exactly
+ * these), module=<name or path prefix>, grep=<text or regex>. With a
+ * filter, n= is the last n matching lines and "matched" counts all
+ * matches after the cursor, so a UI can page without fetching them.
+ * format=structured returns the fields parsed at ingest instead of the
+ * raw text: {"seq","ts","level","module","msg"}.
+ * @param c
  * @param r
+ * @param nodeId
  */
-void HttpServer::handleLogs(QTcpSocket *s, const Request &r)
+void HttpServer::handleLogs(HttpConnection *c, const Request &r, QByteArrayView nodeId, const QDeadlineTimer &deadline)
 {
-    auto *n = nodeForId(r.idParam);
+    auto *n = nodeForId(nodeId);
     if (!n) {
-        writeNotFound(s, "unknown id");
+        writeNotFound(c, "unknown id");
         return;
     }
 
-    int nlines = 200;
-    const auto it = r.query.constFind("n");
-    if (it != r.query.cend()) {
+    // Same query on an unchanged store gives the same answer
+    const QByteArray etag = logETag(n, r);
+    QByteArray clientTag;
+    if (matchesETag(r, etag, &clientTag)) {
+        if (!deadline.hasExpired()) {
+            const QByteArray id = nodeId.toByteArray();
+            LongPoll::start(c, { n }, LongPoll::Watch::Log, deadline, [this, c, r, id, deadline] {
+                handleLogs(c, r, id, deadline);
+            });
+            return;
+        }
+        writeNotModified(c, clientTag);
+        return;
+    }
+
+    auto intParam = [&r](QByteArrayView key, int fallback) {
+        bool found = false;
+        const QByteArray value = r.queryItem(key, &found);
+        if (found) {
+            bool ok = false;
+            const int v = value.toInt(&ok);
+            if (ok && v > 0) {
+                return v;
+            }
+        }
+        return fallback;
+    };
+
+    bool hasFrom = false;
+    bool hasTo = false;
+    r.queryItem("from", &hasFrom);
+    r.queryItem("to", &hasTo);
+    if (hasFrom || hasTo) {
+        handleLogRange(c, r, n, etag);
+        return;
+    }
+
+    INodeController::LogFilter filter;
+    QString filterError;
+    if (!parseLogFilter(r, &filter, &filterError)) {
+        writeBadRequest(c, filterError);
+        return;
+    }
+    const bool filtered = filter.levels || !filter.module.isEmpty() || filter.text;
+    const QByteArray format = r.queryItem("format");
+    if (!format.isEmpty() && format != "raw" && format != "structured") {
+        writeBadRequest(c, "format must be raw or structured");
+        return;
+    }
+    const bool structured = (format == "structured");
+
+    quint64 since = 0;
+    int limit = 0;
+    int skip = 0;
+    bool hasSince = false;
+    const QByteArray sinceValue = r.queryItem("since", &hasSince);
+    if (hasSince) {
         bool ok = false;
-        int v = it.value().toInt(&ok);
-        if (ok && v > 0) {
-            nlines = v;
+        since = sinceValue.toULongLong(&ok);
+        if (!ok) {
+            writeBadRequest(c, "since must be a sequence number");
+            return;
         }
+        limit = qMin(intParam("limit", kDefaultLogLimit), kMaxLogLimit);
+    } else if (filtered) {
+        // Last n matches: count first, then skip all but those
+        limit = intParam("n", 200);
+        int total = 0;
+        n->visitLogFiltered(0, 0, 0, filter, [](const INodeController::LogRecord &) {}, nullptr, &total);
+        skip = qMax(0, total - limit);
+    } else {
+        limit = intParam("n", 200);
+        const quint64 newest = n->visitLogSince(0, 0, [](quint64, QByteArrayView) {});
+        since = newest > quint64(limit) ? newest - quint64(limit) : 0;
     }
 
-    const QStringList lines = n->lastLogLines(nlines);
-    QJsonObject out{
-        { "id", r.idParam },
-        { "lines", QJsonArray::fromStringList(lines) }
+    // Serialized straight from the log store, no per-line QString
+    QByteArray lines;
+    quint64 firstSeq = 0;
+    quint64 firstSent = 0;
+    quint64 lastSent = 0;
+    int matched = 0;
+    auto collect = [&](quint64 after) {
+        lines.clear();
+        lines.reserve(4096);
+        firstSent = lastSent = 0;
+        auto beginLine = [&](quint64 seq) {
+            if (firstSent == 0) {
+                firstSent = seq;
+            } else {
+                lines += ',';
+            }
+            lastSent = seq;
+        };
+        if (filtered || structured) {
+            return n->visitLogFiltered(after, skip, limit, filter, [&](const INodeController::LogRecord &rec) {
+                beginLine(rec.seq);
+                if (structured) {
+                    appendLogRecord(lines, rec);
+                } else {
+                    JsonWriter::appendString(lines, rec.line);
+                }
+            }, &firstSeq, &matched);
+        }
+        return n->visitLogSince(after, limit, [&](quint64 seq, QByteArrayView line) {
+            beginLine(seq);
+            JsonWriter::appendString(lines, line);
+        }, &firstSeq);
+    };
+
+    quint64 newest = collect(since);
+    bool dropped = hasSince && since + 1 < firstSeq;
+    if (since > newest) {
+        // Cursor from before a controller restart: start over from the oldest line
+        dropped = true;
+        newest = collect(0);
+    }
+    quint64 next = lastSent ? lastSent : qMin(since, newest);
+    if (filtered && matched - skip <= limit) {
+        // Every match was returned, the scan covered the store up to newest
+        next = qMax(next, newest);
+    }
+
+    QByteArray payload;
+    payload.reserve(lines.size() + 128);
+    payload += "{\"id\":";
+    JsonWriter::appendString(payload, n->id().toUtf8());
+    payload += ",\"first\":" + QByteArray::number(firstSent);
+    payload += ",\"next\":" + QByteArray::number(next);
+    payload += dropped ? ",\"dropped\":true" : ",\"dropped\":false";
+    if (filtered) {
+        payload += ",\"matched\":" + QByteArray::number(matched);
+    }
+    payload += ",\"lines\":[";
+    payload += lines;
+    payload += "]}";
+
+    writeJsonRaw(c, 200, payload, etag);
+}
+
+/**
+ * @brief HttpServer::handleMetrics
+ * GET /metrics in Prometheus text format: HTTP and upstream counters from
+ * HttpMetrics, open connections, per-node totals and upstream pool state.
+ * @param c
+ */
+void HttpServer::handleMetrics(HttpConnection *c)
+{
+    QByteArray out;
+    out.reserve(32 * 1024);
+    HttpMetrics::instance()->appendPrometheus(out);
+
+    int connections = 0;
+    for (const HttpWorker *w : m_workers) {
+        connections += w->connectionCount();
+    }
+    HttpMetrics::appendHeader(out, "grin_controller_http_connections", "gauge", "Open client connections.");
+    out += "grin_controller_http_connections " + QByteArray::number(connections) + '\n';
+
+    struct NodeSeries {
+        const char *name;
+        const char *type;
+        const char *help;
+        quint64 (*value)(const INodeController *n, const INodeController::Counters &c);
+    };
+    static const NodeSeries kSeries[] = {
+        { "grin_controller_node_up", "gauge", "1 while the node process runs.",
+          [](const INodeController *n, const INodeController::Counters &) { return quint64(n->isRunning()); } },
+        { "grin_controller_node_starts_total", "counter", "Node process starts.",
+          [](const INodeController *, const INodeController::Counters &c) { return c.starts; } },
+        { "grin_controller_node_exits_total", "counter", "Node process exits.",
+          [](const INodeController *, const INodeController::Counters &c) { return c.exits; } },
+        { "grin_controller_log_lines_ingested_total", "counter", "Log lines read from the node.",
+          [](const INodeController *, const INodeController::Counters &c) { return c.linesIngested; } },
+        { "grin_controller_log_lines_dropped_total", "counter", "Log lines evicted from the in-memory buffer.",
+          [](const INodeController *, const INodeController::Counters &c) { return c.linesDropped; } },
+        { "grin_controller_log_bytes_dropped_total", "counter", "Node output dropped because log ingest fell behind.",
+          [](const INodeController *, const INodeController::Counters &c) { return c.bytesDropped; } },
+    };
+
+    QVector<INodeController::Counters> counters;
+    counters.reserve(m_nodes.size());
+    for (auto it = m_nodes.cbegin(); it != m_nodes.cend(); ++it) {
+        counters.append(it.value()->counters());
+    }
+    for (const NodeSeries &s : kSeries) {
+        HttpMetrics::appendHeader(out, s.name, s.type, s.help);
+        int i = 0;
+        for (auto it = m_nodes.cbegin(); it != m_nodes.cend(); ++it, ++i) {
+            out += s.name;
+            out += "{node=";
+            HttpMetrics::appendLabelValue(out, it.key().toUtf8());
+            out += "} " + QByteArray::number(s.value(it.value(), counters[i])) + '\n';
+        }
+    }
+
+    struct PoolSeries {
+        const char *name;
+        const char *type;
+        const char *help;
+        double (*value)(const UpstreamPool::Stats &s);
     };
-    writeJson(s, 200, out);
+    static const PoolSeries kPoolSeries[] = {
+        { "grin_controller_upstream_max_concurrent", "gauge", "Proxied calls allowed at once.",
+          [](const UpstreamPool::Stats &s) { return double(s.maxConcurrent); } },
+        { "grin_controller_upstream_in_flight", "gauge", "Proxied calls running.",
+          [](const UpstreamPool::Stats &s) { return double(s.inFlight); } },
+        { "grin_controller_upstream_queued", "gauge", "Proxied calls waiting for a slot.",
+          [](const UpstreamPool::Stats &s) { return double(s.queued); } },
+        { "grin_controller_upstream_granted_total", "counter", "Proxied calls admitted.",
+          [](const UpstreamPool::Stats &s) { return double(s.granted); } },
+        { "grin_controller_upstream_queued_total", "counter", "Proxied calls that had to wait.",
+          [](const UpstreamPool::Stats &s) { return double(s.queuedTotal); } },
+        { "grin_controller_upstream_rejected_total", "counter", "Proxied calls rejected with a full queue.",
+          [](const UpstreamPool::Stats &s) { return double(s.rejected); } },
+        { "grin_controller_upstream_timed_out_total", "counter", "Proxied calls that hit the queue deadline.",
+          [](const UpstreamPool::Stats &s) { return double(s.timedOut); } },
+        { "grin_controller_upstream_abandoned_total", "counter", "Queued proxied calls whose client went away.",
+          [](const UpstreamPool::Stats &s) { return double(s.abandoned); } },
+        { "grin_controller_upstream_queue_wait_seconds_total", "counter", "Time admitted calls spent in the queue.",
+          [](const UpstreamPool::Stats &s) { return double(s.queueWaitMsTotal) / 1000.0; } },
+    };
+
+    QVector<UpstreamPool::Stats> poolStats;
+    poolStats.reserve(m_pools.size());
+    for (auto it = m_pools.cbegin(); it != m_pools.cend(); ++it) {
+        poolStats.append(it.value()->stats());
+    }
+    for (const PoolSeries &s : kPoolSeries) {
+        HttpMetrics::appendHeader(out, s.name, s.type, s.help);
+        int i = 0;
+        for (auto it = m_pools.cbegin(); it != m_pools.cend(); ++it, ++i) {
+            out += s.name;
+            out += "{node=";
+            HttpMetrics::appendLabelValue(out, it.key().toUtf8());
+            out += "} " + QByteArray::number(s.value(poolStats[i]), 'g', 12) + '\n';
+        }
+    }
+
+    HttpResponse resp(200, HttpResponse::ContentType::Metrics);
+    resp.setContentLength(out.size());
+    c->sendResponse(resp, out);
+}
+
+/**
+ * @brief HttpServer::handleNodeMetrics
+ * GET /metrics/{id}?n=<samples>: CPU, RSS, disk I/O rates and open fds of
+ * the node's process group, oldest sample first (all without n), and the
+ * log store usage.
+ * @param c
+ * @param r
+ * @param nodeId
+ */
+void HttpServer::handleNodeMetrics(HttpConnection *c, const Request &r, QByteArrayView nodeId)
+{
+    auto *n = nodeForId(nodeId);
+    if (!n) {
+        writeNotFound(c, "unknown id");
+        return;
+    }
+
+    int last = 0;
+    bool found = false;
+    const QByteArray value = r.queryItem("n", &found);
+    if (found) {
+        bool ok = false;
+        last = value.toInt(&ok);
+        if (!ok || last <= 0) {
+            writeBadRequest(c, "n must be a positive number");
+            return;
+        }
+    }
+
+    writeJsonRaw(c, 200, n->metricsBytes(last));
+}
+
+/**
+ * @brief HttpServer::handleLogCapacity
+ * POST /logs/{id}/capacity or /logs/capacity (every node) with
+ * {"bytes": 16777216} or {"bytes": "16M"} as body, or ?bytes=16M.
+ * Resizing keeps the newest lines; the log budget (--log-total-bytes)
+ * applies to the sum over all nodes.
+ * @param c
+ * @param r
+ * @param nodeId
+ */
+void HttpServer::handleLogCapacity(HttpConnection *c, const Request &r, QByteArrayView nodeId)
+{
+    QList<INodeController *> targets;
+    if (nodeId.isEmpty()) {
+        targets = m_nodes.values();
+    } else if (INodeController *n = nodeForId(nodeId)) {
+        targets << n;
+    } else {
+        writeNotFound(c, "unknown id");
+        return;
+    }
+
+    QString text = QString::fromUtf8(r.queryItem("bytes"));
+    bool okJson = false;
+    const QJsonObject obj = parseJsonObject(r.body(), &okJson);
+    if (okJson && obj.contains("bytes")) {
+        const QJsonValue v = obj.value("bytes");
+        text = v.isString() ? v.toString() : QString::number(v.toDouble(), 'f', 0);
+    }
+    bool ok = false;
+    const qint64 requested = LogBuffer::parseByteSize(text, &ok);
+    if (!ok || requested <= 0) {
+        writeBadRequest(c, "bytes must be a size like 16777216, 512K, 16M or 1G");
+        return;
+    }
+    const qint64 bytes = qBound(LogBuffer::kMinCapacity, requested, LogBuffer::kMaxCapacity);
+
+    QMutexLocker g(&m_logBudgetMutex);
+    if (m_logBudget > 0) {
+        qint64 total = 0;
+        for (INodeController *n : std::as_const(m_nodes)) {
+            total += targets.contains(n) ? bytes : n->logCapacity();
+        }
+        if (total > m_logBudget) {
+            writeBadRequest(c, QString("log buffers would need %1 bytes, budget is %2 (--log-total-bytes)")
+                            .arg(total).arg(m_logBudget));
+            return;
+        }
+    }
+
+    QJsonObject nodes;
+    for (INodeController *n : std::as_const(targets)) {
+        n->setLogCapacity(bytes);
+        nodes[n->id()] = n->logCapacity();
+    }
+    writeJson(c, 200, QJsonObject{ { "ok", true }, { "capacityBytes", bytes }, { "nodes", nodes } });
+}
+
+/**
+ * @brief HttpServer::appendLogRecord
+ * @param out
+ * @param rec
+ */
+void HttpServer::appendLogRecord(QByteArray &out, const INodeController::LogRecord &rec)
+{
+    out += "{\"seq\":" + QByteArray::number(rec.seq);
+    out += ",\"ts\":";
+    out += rec.tsMs ? QByteArray::number(rec.tsMs) : QByteArray("null");
+    out += ",\"level\":\"";
+    out += LogClassifier::levelName(LogClassifier::Level(rec.level));
+    out += "\",\"module\":";
+    if (rec.module.isEmpty()) {
+        out += "null";
+    } else {
+        JsonWriter::appendString(out, rec.module);
+    }
+    out += ",\"msg\":";
+    JsonWriter::appendString(out, rec.message);
+    out += '}';
+}
+
+/**
+ * @brief HttpServer::parseLogFilter
+ * @param r
+ * @param filter
+ * @param error
+ * @return false with error set for an unknown level or a broken regex
+ */
+bool HttpServer::parseLogFilter(const Request &r, INodeController::LogFilter *filter, QString *error)
+{
+    bool found = false;
+    const QByteArray level = r.queryItem("level", &found);
+    if (found && !level.isEmpty()) {
+        const QList<QByteArray> names = level.split(',');
+        for (const QByteArray &name : names) {
+            LogClassifier::Level l;
+            if (!LogClassifier::parseLevel(name.trimmed(), &l)) {
+                *error = QString("unknown level '%1'").arg(QString::fromUtf8(name));
+                return false;
+            }
+            if (names.size() == 1) {
+                // Single level: it and everything more severe
+                for (int i = LogClassifier::Error; i <= l; ++i) {
+                    filter->levels |= LogClassifier::levelBit(LogClassifier::Level(i));
+                }
+            } else {
+                filter->levels |= LogClassifier::levelBit(l);
+            }
+        }
+    }
+
+    filter->module = r.queryItem("module").trimmed();
+
+    const QByteArray grep = r.queryItem("grep", &found);
+    if (found && !grep.isEmpty()) {
+        QString regexError;
+        const QSharedPointer<const LineMatcher> m = LineMatcher::get(QString::fromUtf8(grep), &regexError);
+        if (!m) {
+            *error = QString("invalid grep pattern: %1").arg(regexError);
+            return false;
+        }
+        filter->text = [m](QByteArrayView line) {
+            return m->matches(line);
+        };
+    }
+    return true;
+}
+
+/**
+ * @brief HttpServer::handleLogRange
+ * /logs/{id}?from=&to=[&since=][&limit=]: history from the disk spool.
+ * Page with since=<next> while "more" is true.
+ * @param c
+ * @param r
+ * @param n
+ */
+void HttpServer::handleLogRange(HttpConnection *c, const Request &r, INodeController *n, const QByteArray &etag)
+{
+    qint64 fromMs = 0;
+    qint64 toMs = std::numeric_limits<qint64>::max();
+    bool found = false;
+    QByteArray value = r.queryItem("from", &found);
+    if (found && !parseTimeParam(value, &fromMs)) {
+        writeBadRequest(c, "from must be a timestamp");
+        return;
+    }
+    value = r.queryItem("to", &found);
+    if (found && !parseTimeParam(value, &toMs)) {
+        writeBadRequest(c, "to must be a timestamp");
+        return;
+    }
+
+    quint64 since = 0;
+    value = r.queryItem("since", &found);
+    if (found) {
+        bool ok = false;
+        since = value.toULongLong(&ok);
+        if (!ok) {
+            writeBadRequest(c, "since must be a sequence number");
+            return;
+        }
+    }
+
+    int limit = kDefaultLogLimit;
+    value = r.queryItem("limit", &found);
+    if (found) {
+        bool ok = false;
+        const int v = value.toInt(&ok);
+        if (ok && v > 0) {
+            limit = qMin(v, kMaxLogLimit);
+        }
+    }
+
+    QByteArray records;
+    records.reserve(4096);
+    quint64 lastSent = 0;
+    bool more = false;
+    const bool available = n->visitLogRange(fromMs, toMs, since, limit,
+                                            [&](quint64 seq, qint64 tsMs, QByteArrayView line) {
+        if (lastSent) {
+            records += ',';
+        }
+        lastSent = seq;
+        records += "{\"seq\":" + QByteArray::number(seq) + ",\"ts\":" + QByteArray::number(tsMs) + ",\"line\":";
+        JsonWriter::appendString(records, line);
+        records += '}';
+    }, &more);
+    if (!available) {
+        writeBadRequest(c, "log spool disabled (--log-spool)");
+        return;
+    }
+
+    QByteArray payload;
+    payload.reserve(records.size() + 160);
+    payload += "{\"id\":";
+    JsonWriter::appendString(payload, n->id().toUtf8());
+    payload += ",\"from\":" + QByteArray::number(fromMs);
+    payload += ",\"to\":" + QByteArray::number(toMs);
+    payload += ",\"next\":" + QByteArray::number(lastSent ? lastSent : since);
+    payload += more ? ",\"more\":true" : ",\"more\":false";
+    payload += ",\"records\":[";
+    payload += records;
+    payload += "]}";
+
+    writeJsonRaw(c, 200, payload, etag);
+}
+
+/**
+ * @brief HttpServer::handleLogStream
+ * Server-Sent Events with one event per new line, the line's sequence
+ * number as event id. Resumes after Last-Event-ID (header, or query
+ * lastEventId for the first EventSource connect); otherwise starts with
+ * the last n lines (default 0).
+ * @param c
+ * @param r
+ * @param nodeId
+ */
+void HttpServer::handleLogStream(HttpConnection *c, const Request &r, QByteArrayView nodeId)
+{
+    auto *n = nodeForId(nodeId);
+    if (!n) {
+        writeNotFound(c, "unknown id");
+        return;
+    }
+
+    bool resume = false;
+    quint64 resumeAfter = 0;
+    QByteArray lastId = r.header("last-event-id").toByteArray();
+    if (lastId.isEmpty()) {
+        lastId = r.queryItem("lastEventId");
+    }
+    if (!lastId.isEmpty()) {
+        resumeAfter = lastId.toULongLong(&resume);
+    }
+
+    int backlog = 0;
+    bool hasN = false;
+    const QByteArray nValue = r.queryItem("n", &hasN);
+    if (hasN) {
+        bool ok = false;
+        const int v = nValue.toInt(&ok);
+        if (ok && v > 0) {
+            backlog = v;
+        }
+    }
+
+    c->beginResponse(HttpResponse(200, HttpResponse::ContentType::EventStream));
+    m_logStreams.subscribe(c, n, resume, resumeAfter, backlog);
+}
+
+/**
+ * @brief HttpServer::callOnNode
+ * Runs call on the thread owning the node's QProcess and writes the result
+ * back on the connection's worker thread (200 if ok, else 500).
+ * @param c
+ * @param n
+ * @param call
+ */
+void HttpServer::callOnNode(HttpConnection *c, INodeController *n, const NodeCall &call)
+{
+    if (n->thread() == QThread::currentThread()) {
+        bool ok = false;
+        const QJsonObject out = call(ok);
+        writeJson(c, ok ? 200 : 500, out);
+        return;
+    }
+
+    // The connection stays alive while its response is pending, the
+    // QPointer only guards against a worker shutdown in between.
+    QPointer<HttpConnection> guard(c);
+    HttpWorker *worker = c->worker();
+    QMetaObject::invokeMethod(n, [guard, worker, call] {
+        bool ok = false;
+        const QJsonObject out = call(ok);
+        QMetaObject::invokeMethod(worker, [guard, ok, out] {
+            if (guard) {
+                writeJson(guard, ok ? 200 : 500, out);
+            }
+        }, Qt::QueuedConnection);
+    }, Qt::QueuedConnection);
 }
 
 /**
@@ -443,13 +1229,16 @@ void HttpServer::handleLogs(QTcpSocket *s, const Request &r)
  * @param id
  * @return
  */
-INodeController *HttpServer::nodeForId(const QString &id) const
+INodeController *HttpServer::nodeForId(QByteArrayView id) const
 {
-    auto it = m_nodes.constFind(id);
-    if (it == m_nodes.cend()) {
-        return nullptr;
+    // ids are short ASCII and there are only a few nodes
+    const QLatin1StringView key(id.data(), id.size());
+    for (auto it = m_nodes.cbegin(); it != m_nodes.cend(); ++it) {
+        if (it.key() == key) {
+            return it.value();
+        }
     }
-    return it.value();
+    return nullptr;
 }
 
 /**
@@ -458,7 +1247,7 @@ INodeController *HttpServer::nodeForId(const QString &id) const
  * @param okOut
  * @return
  */
-QJsonObject HttpServer::parseJsonObject(const QByteArray &body, bool *okOut)
+QJsonObject HttpServer::parseJsonObject(QByteArrayView body, bool *okOut)
 {
     if (okOut) {
         *okOut = false;
@@ -466,7 +1255,8 @@ QJsonObject HttpServer::parseJsonObject(const QByteArray &body, bool *okOut)
     if (body.isEmpty()) {
         return {};
     }
-    const QJsonDocument doc = QJsonDocument::fromJson(body);
+    // No copy, the view lives as long as the request
+    const QJsonDocument doc = QJsonDocument::fromJson(QByteArray::fromRawData(body.data(), body.size()));
     if (!doc.isNull() && doc.isObject()) {
         if (okOut) {
             *okOut = true;
@@ -477,213 +1267,253 @@ QJsonObject HttpServer::parseJsonObject(const QByteArray &body, bool *okOut)
 }
 
 /**
- * @brief HttpServer::parseQuery
- * @param rawQuery
- * @return
+ * @brief HttpServer::writeJson
+ * @param c
+ * @param statusCode
+ * @param obj
  */
-QMap<QByteArray, QByteArray> HttpServer::parseQuery(const QByteArray &rawQuery)
+void HttpServer::writeJson(HttpConnection *c, int statusCode, const QJsonObject &obj)
 {
-    QMap<QByteArray, QByteArray> m;
-    QUrlQuery q(QString::fromUtf8(rawQuery));
-    const auto items = q.queryItems(QUrl::FullyDecoded);
-    for (const auto &it : items) {
-        m.insert(it.first.toUtf8(), it.second.toUtf8());
-    }
-    return m;
+    writeJsonRaw(c, statusCode, QJsonDocument(obj).toJson(QJsonDocument::Compact));
 }
 
 /**
- * @brief HttpServer::readHttpRequest
- * @param s
- * @param outReq
- * @return
+ * @brief HttpServer::writeJsonRaw
+ * @param c
+ * @param statusCode
+ * @param payload serialized JSON
  */
-bool HttpServer::readHttpRequest(QTcpSocket *s, Request &outReq)
+void HttpServer::writeJsonRaw(HttpConnection *c, int statusCode, const QByteArray &payload, const QByteArray &etag)
 {
-    bool log = false;
-
-    // Wait for header
-    if (!s->waitForReadyRead(5000)) {
-        return false;
+    HttpResponse resp(statusCode);
+    resp.setContentLength(payload.size());
+    if (!etag.isEmpty()) {
+        resp.setETag(etag);
+        resp.addHeader("Access-Control-Expose-Headers", "ETag");
     }
 
-    QByteArray data = s->readAll();
+    c->sendResponse(resp, payload);
+}
+
+/**
+ * @brief HttpServer::writeNotModified
+ * @param c
+ * @param etag the client's matching tag, including its content coding
+ */
+void HttpServer::writeNotModified(HttpConnection *c, const QByteArray &etag)
+{
+    HttpResponse resp(304, HttpResponse::ContentType::None);
+    resp.setETag(etag);
+    resp.addHeader("Access-Control-Expose-Headers", "ETag");
+
+    c->sendResponse(resp);
+}
 
-    int headerEnd = data.indexOf("\r\n\r\n");
-    const int headerEndAlt = data.indexOf("\n\n");
-    if (headerEnd < 0 && headerEndAlt >= 0) {
-        headerEnd = headerEndAlt + 2; // Fallback
+/**
+ * @brief HttpServer::statusETag
+ * From the version counters. The body has no uptime (clients derive it
+ * from startedAt), no log counters (/metrics/{id}) and no upstream pool
+ * counters (/metrics), which move with every proxied call.
+ * @return
+ */
+QByteArray HttpServer::statusETag() const
+{
+    QVector<quint64> parts;
+    parts.reserve(m_nodes.size());
+    for (auto it = m_nodes.cbegin(); it != m_nodes.cend(); ++it) {
+        // Read before the snapshot fields so a concurrent change moves the tag
+        parts.append(it.value()->statusVersion());
     }
-    if (headerEnd < 0) {
-        while (headerEnd < 0 && s->waitForReadyRead(2000)) {
-            data += s->readAll();
-            headerEnd = data.indexOf("\r\n\r\n");
-            if (headerEnd < 0) {
-                int he2 = data.indexOf("\n\n");
-                if (he2 >= 0) {
-                    headerEnd = he2 + 2;
-                }
-            }
-        }
-        if (headerEnd < 0) {
-            return false;
+    return makeETag(parts);
+}
+
+/**
+ * @brief HttpServer::logETag
+ * @param n
+ * @param r
+ * @return
+ */
+QByteArray HttpServer::logETag(INodeController *n, const Request &r)
+{
+    QByteArray key = n->id().toUtf8();
+    key += '?';
+    // wait= only changes how long we hold the request, not the answer
+    const QList<QByteArray> items = r.query().toByteArray().split('&');
+    for (const QByteArray &item : items) {
+        if (!item.startsWith("wait=") && item != "wait") {
+            key += item;
+            key += '&';
         }
     }
+    return makeETag({ n->logVersion() }, key);
+}
 
-    QByteArray head = data.left(headerEnd);
-    QByteArray body = data.mid(headerEnd + 4);
-    if (data.mid(headerEnd, 4) == "\n\n") {
-        body = data.mid(headerEnd);
-    }
-    const QList<QByteArray> lines = head.split('\n');
-    if (lines.isEmpty()) {
-        return false;
+/**
+ * @brief HttpServer::makeETag
+ * Strong tag: 64-bit hash of the parts, seeded per process because the
+ * counters start over with every controller start.
+ * @param parts
+ * @param extra
+ * @return quoted tag
+ */
+QByteArray HttpServer::makeETag(const QVector<quint64> &parts, QByteArrayView extra)
+{
+    static const size_t processSeed = size_t(QRandomGenerator::system()->generate64());
+
+    size_t h = qHashBits(parts.constData(), size_t(parts.size()) * sizeof(quint64), processSeed);
+    if (!extra.isEmpty()) {
+        h = qHashBits(extra.data(), size_t(extra.size()), h);
     }
+    return '"' + QByteArray::number(quint64(h), 16) + '"';
+}
 
-    const QByteArray requestLine = lines.first().trimmed(); // "GET /status HTTP/1.1"
-    const QList<QByteArray> parts = requestLine.split(' ');
-    if (parts.size() < 2) {
+/**
+ * @brief HttpServer::matchesETag
+ * If-None-Match uses weak comparison: "*", a list, W/ prefixes. A tag
+ * with a content coding suffix ("<tag>-gz") matches the identity tag,
+ * the body is the same before compression.
+ * @param r
+ * @param etag
+ * @param matched receives the client's tag without W/, for the 304
+ * @return
+ */
+bool HttpServer::matchesETag(const Request &r, const QByteArray &etag, QByteArray *matched)
+{
+    const QByteArrayView value = r.header("if-none-match");
+    if (value.isEmpty()) {
         return false;
     }
 
-    outReq.method = parts[0].trimmed();
-
-    QByteArray urlPart = parts[1].trimmed(); // no path + ?query
-    outReq.httpVersion = (parts.size() >= 3) ? parts[2].trimmed() : "HTTP/1.1";
-
-    // Headers
-    for (int i = 1; i < lines.size(); ++i) {
-        const QByteArray line = lines[i].trimmed();
-        if (line.isEmpty()) {
-            continue;
+    const QList<QByteArray> tags = value.toByteArray().split(',');
+    for (QByteArray tag : tags) {
+        tag = tag.trimmed();
+        if (tag == "*") {
+            if (matched) {
+                *matched = etag;
+            }
+            return true;
         }
-        int colon = line.indexOf(':');
-        if (colon > 0) {
-            QByteArray k = line.left(colon).trimmed().toLower();
-            QByteArray v = line.mid(colon + 1).trimmed();
-            outReq.headers.insert(k, v);
+        if (tag.startsWith("W/")) {
+            tag.remove(0, 2);
         }
-    }
-
-    // Query & Path split
-    int qpos = urlPart.indexOf('?');
-    QByteArray rawPath = (qpos >= 0) ? urlPart.left(qpos) : urlPart;
-    QByteArray rawQuery = (qpos >= 0) ? urlPart.mid(qpos + 1) : QByteArray();
-
-    outReq.path = rawPath;
-    outReq.query = parseQuery(rawQuery);
-
-    // Body with Content-Length
-    int contentLen = 0;
-    bool okLen = false;
-    if (outReq.headers.contains("content-length")) {
-        contentLen = outReq.headers.value("content-length").toInt(&okLen);
-    }
-    QByteArray buf = body;
-    if (okLen && contentLen > buf.size()) {
-        int remain = contentLen - buf.size();
-        while (remain > 0 && s->waitForReadyRead(3000)) {
-            QByteArray chunk = s->read(qMin(8192, remain));
-            buf += chunk;
-            remain -= chunk.size();
+        QByteArray base = tag;
+        for (const HttpCompressor::Encoding coding : { HttpCompressor::Encoding::Gzip,
+                                                       HttpCompressor::Encoding::Deflate }) {
+            const QByteArray suffix = HttpCompressor::etagSuffix(coding).toByteArray() + '"';
+            if (base.endsWith(suffix)) {
+                base.chop(suffix.size());
+                base += '"';
+                break;
+            }
+        }
+        if (base == etag) {
+            if (matched) {
+                *matched = tag;
+            }
+            return true;
         }
     }
-    outReq.body = buf;
-
-    if (log) {
-        qDebug() << "Request:";
-        qDebug() << outReq.body;
-        qDebug() << outReq.headers;
-        qDebug() << outReq.httpVersion;
-        qDebug() << outReq.idParam;
-        qDebug() << outReq.method;
-        qDebug() << outReq.path;
-        qDebug() << outReq.query;
-    }
-
-    return true;
+    return false;
 }
 
 /**
- * @brief HttpServer::writeJson
- * @param s
- * @param statusCode
- * @param obj
+ * @brief HttpServer::waitDeadline
+ * @param r
+ * @return deadline of ?wait=<ms> (capped), expired without it
  */
-void HttpServer::writeJson(QTcpSocket *s, int statusCode, const QJsonObject &obj)
+QDeadlineTimer HttpServer::waitDeadline(const Request &r)
 {
-    const QByteArray payload = QJsonDocument(obj).toJson(QJsonDocument::Compact);
-
-    QByteArray resp;
-    resp += httpStatusLine(statusCode);
-    resp += "Content-Type: application/json\r\n";
-    resp += "Content-Length: " + QByteArray::number(payload.size()) + "\r\n";
-    resp += "Access-Control-Allow-Origin: *\r\n";
-    resp += "Access-Control-Allow-Methods: GET, POST, OPTIONS\r\n";
-    resp += "Access-Control-Allow-Headers: Content-Type, Authorization\r\n";
-    resp += "Connection: close\r\n\r\n";
-    resp += payload;
-
-    s->write(resp);
-    s->flush();
+    bool found = false;
+    const QByteArray value = r.queryItem("wait", &found);
+    if (!found) {
+        return QDeadlineTimer(0);
+    }
+    bool ok = false;
+    const int ms = value.toInt(&ok);
+    if (!ok || ms <= 0) {
+        return QDeadlineTimer(0);
+    }
+    return QDeadlineTimer(qMin(ms, kMaxWaitMs));
 }
 
 /**
  * @brief HttpServer::writeNoContentCors
- * @param s
+ * @param c
  */
-void HttpServer::writeNoContentCors(QTcpSocket *s)
+void HttpServer::writeNoContentCors(HttpConnection *c)
 {
-    QByteArray resp;
-    resp += httpStatusLine(204);
-    resp += "Access-Control-Allow-Origin: *\r\n";
-    resp += "Access-Control-Allow-Methods: GET, POST, OPTIONS\r\n";
-    resp += "Access-Control-Allow-Headers: Content-Type, Authorization\r\n";
-    resp += "Connection: close\r\n\r\n";
-    s->write(resp);
-    s->flush();
+    c->sendResponse(HttpResponse(204, HttpResponse::ContentType::None));
 }
 
-void HttpServer::writeNoContentCors(QTcpSocket *s, const QByteArray &allowHeaders)
+void HttpServer::writeNoContentCors(HttpConnection *c, const QByteArray &allowHeaders)
 {
-    QByteArray resp;
-    resp += httpStatusLine(204);
-    resp += "Access-Control-Allow-Origin: *\r\n";
-    resp += "Access-Control-Allow-Methods: GET, POST, OPTIONS\r\n";
-    resp += "Access-Control-Allow-Headers: " + allowHeaders + "\r\n";
-    resp += "Connection: close\r\n\r\n";
-    s->write(resp);
-    s->flush();
+    HttpResponse resp(204, HttpResponse::ContentType::None);
+    resp.setAllowHeaders(allowHeaders);
+
+    c->sendResponse(resp);
 }
 
 /**
  * @brief HttpServer::writeNotFound
- * @param s
+ * @param c
  * @param msg
  */
-void HttpServer::writeNotFound(QTcpSocket *s, const QString &msg)
+void HttpServer::writeNotFound(HttpConnection *c, const QString &msg)
 {
-    writeJson(s, 404, QJsonObject{{"error", msg}});
+    writeJson(c, 404, QJsonObject{{"error", msg}});
 }
 
 /**
  * @brief HttpServer::writeBadRequest
- * @param s
+ * @param c
  * @param msg
  */
-void HttpServer::writeBadRequest(QTcpSocket *s, const QString &msg)
+void HttpServer::writeBadRequest(HttpConnection *c, const QString &msg)
 {
-    writeJson(s, 400, QJsonObject{{"error", msg}});
+    writeJson(c, 400, QJsonObject{{"error", msg}});
 }
 
 /**
  * @brief HttpServer::writeServerError
- * @param s
+ * @param c
+ * @param msg
+ */
+void HttpServer::writeServerError(HttpConnection *c, const QString &msg)
+{
+    writeJson(c, 500, QJsonObject{{"error", msg}});
+}
+
+/**
+ * @brief HttpServer::writeServiceUnavailable
+ * @param c
  * @param msg
+ * @param retryAfterSec
  */
-void HttpServer::writeServerError(QTcpSocket *s, const QString &msg)
+void HttpServer::writeServiceUnavailable(HttpConnection *c, const QString &msg, int retryAfterSec)
 {
-    writeJson(s, 500, QJsonObject{{"error", msg}});
+    const QByteArray payload = QJsonDocument(QJsonObject{{"error", msg}}).toJson(QJsonDocument::Compact);
+
+    HttpResponse resp(503);
+    resp.addHeader("Retry-After", QByteArray::number(retryAfterSec));
+    resp.setContentLength(payload.size());
+
+    c->sendResponse(resp, payload);
+}
+
+/**
+ * @brief HttpServer::writeMethodNotAllowed
+ * @param c
+ * @param allow methods of the requested path
+ */
+void HttpServer::writeMethodNotAllowed(HttpConnection *c, const QByteArray &allow)
+{
+    const QByteArray payload = QJsonDocument(QJsonObject{{"error", "method not allowed"}}).toJson(QJsonDocument::Compact);
+
+    HttpResponse resp(405);
+    resp.addHeader("Allow", allow);
+    resp.setContentLength(payload.size());
+
+    c->sendResponse(resp, payload);
 }
 
 /**
@@ -693,61 +1523,61 @@ void HttpServer::writeServerError(QTcpSocket *s, const QString &msg)
 bool HttpServer::anyNodeRunning() const
 {
     for (auto it = m_nodes.cbegin(); it != m_nodes.cend(); ++it) {
-        const QJsonObject st = it.value()->statusJson();
-        if (st.value("running").toBool()) {
+        if (it.value()->isRunning()) {
             return true;
         }
     }
     return false;
 }
 
-void HttpServer::handleOwnerProxy(QTcpSocket *s, const Request &r)
+void HttpServer::handleOwnerProxy(HttpConnection *c, const Request &r)
 {
     if (!anyNodeRunning()) {
-        writeServerError(s, "No active node to handle /v2/owner");
+        writeServerError(c, "No active node to handle /v2/owner");
         return;
     }
 
     const QString url = proxyEndpointUrl(QStringLiteral("v2/owner"));
 
     QString apiKey;
+    UpstreamPool *pool = nullptr;
 
     if (INodeController *n = firstRunningNode()) {
-        const QJsonObject st = n->statusJson();
-        apiKey = st.value(QStringLiteral("ownerApiKey")).toString();
+        apiKey = n->ownerApiKey();
+        pool = m_pools.value(n->id());
     }
 
-    proxyToUrl(s, url, r, apiKey);
+    proxyToUrl(c, url, r, apiKey, pool);
 }
 
-void HttpServer::handleForeignProxy(QTcpSocket *s, const Request &r)
+void HttpServer::handleForeignProxy(HttpConnection *c, const Request &r)
 {
     if (!anyNodeRunning()) {
-        writeServerError(s, "No active node to handle /v2/foreign");
+        writeServerError(c, "No active node to handle /v2/foreign");
         return;
     }
 
     const QString url = proxyEndpointUrl(QStringLiteral("v2/foreign"));
 
     QString apiKey;
+    UpstreamPool *pool = nullptr;
 
     if (INodeController *n = firstRunningNode()) {
-        const QJsonObject st = n->statusJson();
-        apiKey = st.value(QStringLiteral("foreignApiKey")).toString();
+        apiKey = n->foreignApiKey();
+        pool = m_pools.value(n->id());
     }
 
-    proxyToUrl(s, url, r, apiKey);
+    proxyToUrl(c, url, r, apiKey, pool);
 }
 
-void HttpServer::proxyToUrl(QTcpSocket *s, const QString &url, const Request &r, const QString &apiKey)
+void HttpServer::proxyToUrl(HttpConnection *c, const QString &url, const Request &r, const QString &apiKey,
+                            UpstreamPool *pool)
 {
-    QNetworkAccessManager mgr;
     QNetworkRequest req{ QUrl(url) };
 
     // Content-Type übernehmen oder Default setzen
-    auto itCt = r.headers.constFind("content-type");
-    if (itCt != r.headers.cend()) {
-        req.setRawHeader("Content-Type", itCt.value());
+    if (r.hasHeader("content-type")) {
+        req.setRawHeader("Content-Type", r.header("content-type").toByteArray());
     } else {
         req.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
     }
@@ -760,28 +1590,91 @@ void HttpServer::proxyToUrl(QTcpSocket *s, const QString &url, const Request &r,
     if (!apiKey.isEmpty()) {
         req.setRawHeader("Authorization", makeBasicAuthHeader(apiKey));
     } else {
-        auto itAuth = r.headers.constFind("authorization");
-        if (itAuth != r.headers.cend()) {
-            req.setRawHeader("Authorization", itAuth.value());
+        if (r.hasHeader("authorization")) {
+            req.setRawHeader("Authorization", r.header("authorization").toByteArray());
         }
     }
 
-    QNetworkReply *reply = mgr.post(req, r.body);
-    QEventLoop loop;
-    QObject::connect(reply, &QNetworkReply::finished, &loop, &QEventLoop::quit);
-    loop.exec();
+    if (!pool) {
+        startProxy(c, req, r.body().toByteArray(), url, nullptr);
+        return;
+    }
 
-    int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
-    if (status == 0) {
-        qWarning() << "[proxy]" << url << "network error:"
-                   << reply->error() << reply->errorString();
-        status = 500;
+    // Admission control: the node only sees a bounded number of calls.
+    // wait lives while the call is queued; deleting it ends the deadline
+    // timer and the close watch.
+    QPointer<HttpConnection> guard(c);
+    QPointer<QObject> wait(new QObject(c));
+    const QByteArray body = r.body().toByteArray();
+    quint64 ticket = 0;
+    const UpstreamPool::Admission adm = pool->acquire(c->worker(), [guard, wait, req, body, url, pool] {
+        delete wait.data();
+        if (!guard || guard->isClosed()) {
+            pool->release();
+            if (guard) {
+                guard->abortResponse();
+            }
+            return;
+        }
+        startProxy(guard, req, body, url, pool);
+    }, &ticket);
+
+    const int retryAfterSec = qMax(1, (pool->queueTimeoutMs() + 999) / 1000);
+
+    switch (adm) {
+    case UpstreamPool::Admission::Granted:
+        delete wait.data();
+        startProxy(c, req, body, url, pool);
+        break;
+    case UpstreamPool::Admission::Rejected:
+        delete wait.data();
+        writeServiceUnavailable(c, QStringLiteral("node rpc busy"), retryAfterSec);
+        break;
+    case UpstreamPool::Admission::Queued:
+        // Client gone: give the queue slot back instead of holding it to the deadline
+        QObject::connect(c, &HttpConnection::closed, wait.data(), [c, pool, ticket, wait] {
+            if (pool->cancel(ticket, UpstreamPool::CancelReason::ClientGone)) {
+                c->abortResponse();
+            }
+            wait->deleteLater();
+        });
+        // Deadline: still waiting afterwards -> 503
+        QTimer::singleShot(pool->queueTimeoutMs(), wait.data(), [c, pool, ticket, retryAfterSec, wait] {
+            if (pool->cancel(ticket, UpstreamPool::CancelReason::Timeout)) {
+                writeServiceUnavailable(c, QStringLiteral("node rpc queue timeout"), retryAfterSec);
+            }
+            wait->deleteLater();
+        });
+        break;
     }
+}
 
-    const QByteArray payload = reply->readAll();
-    reply->deleteLater();
+/**
+ * @brief HttpServer::startProxy
+ * Sends the call upstream once a slot in the node's pool is held.
+ * @param c
+ * @param req
+ * @param body buffered body, unused if the body is streamed
+ * @param url
+ * @param pool released by the relay when the call is done
+ */
+void HttpServer::startProxy(HttpConnection *c, const QNetworkRequest &req, const QByteArray &body,
+                            const QString &url, UpstreamPool *pool)
+{
+    // Shared manager of this worker: upstream connections are reused and
+    // the reply is streamed to the client by the relay as it arrives.
+    QNetworkRequest upstream(req);
+    QNetworkReply *reply = nullptr;
+    if (HttpBodyStream *stream = c->requestBody()) {
+        // Body still arriving from the client: forward it as it comes
+        upstream.setHeader(QNetworkRequest::ContentLengthHeader, stream->totalSize());
+        upstream.setAttribute(QNetworkRequest::DoNotBufferUploadDataAttribute, true);
+        reply = c->worker()->network()->post(upstream, stream);
+    } else {
+        reply = c->worker()->network()->post(upstream, body);
+    }
 
-    writeJsonRaw(s, status, payload);
+    new ProxyRelay(c, reply, url, pool);
 }
 
 QString HttpServer::proxyEndpointUrl(const QString &endpoint) const
@@ -801,27 +1694,10 @@ quint16 HttpServer::nodeRpcPort() const
     return m_nodeRpcPort;
 }
 
-void HttpServer::writeJsonRaw(QTcpSocket *s, int statusCode, const QByteArray &payload)
-{
-    QByteArray resp;
-    resp += httpStatusLine(statusCode);
-    resp += "Content-Type: application/json\r\n";
-    resp += "Content-Length: " + QByteArray::number(payload.size()) + "\r\n";
-    resp += "Access-Control-Allow-Origin: *\r\n";
-    resp += "Access-Control-Allow-Methods: GET, POST, OPTIONS\r\n";
-    resp += "Access-Control-Allow-Headers: Content-Type, Authorization\r\n";
-    resp += "Connection: close\r\n\r\n";
-    resp += payload;
-
-    s->write(resp);
-    s->flush();
-}
-
 INodeController *HttpServer::firstRunningNode() const
 {
     for (auto it = m_nodes.cbegin(); it != m_nodes.cend(); ++it) {
-        const QJsonObject st = it.value()->statusJson();
-        if (st.value("running").toBool()) {
+        if (it.value()->isRunning()) {
             return it.value();
         }
     }
@@ -11,7 +11,6 @@
 #include <QJsonDocument>
 #include <QJsonArray>
 #include <QUrl>
-#include <QUrlQuery>
 #include <QRegularExpression>
 #include <QScopedPointer>
 #include <QDir>
@@ -19,77 +18,159 @@
 
 #include <QNetworkAccessManager>
 #include <QNetworkRequest>
-#include <QEventLoop>
 #include <QNetworkReply>
+#include <QThread>
+#include <QVector>
+#include <QPointer>
+#include <QTimer>
+#include <QMutex>
+#include <QDeadlineTimer>
+
+#include <functional>
 
 #include "inodecontroller.h"
+#include "httpconnection.h"
+#include "httprequest.h"
+#include "httprouter.h"
+#include "httpworker.h"
+#include "httpmetrics.h"
+#include "jsonwriter.h"
+#include "linematcher.h"
+#include "logclassifier.h"
+#include "logstreamhub.h"
+#include "longpoll.h"
+#include "httpresponse.h"
+#include "httpbodystream.h"
+#include "proxyrelay.h"
+#include "upstreampool.h"
 
-class HttpServer : public QObject
+class HttpServer : public QObject, public HttpRequestHandler
 {
     Q_OBJECT
 public:
     explicit HttpServer(QObject *parent = nullptr);
+    ~HttpServer() override;
 
     void registerNode(INodeController *node); // id
     bool listen(quint16 port = 8080, const QHostAddress &addr = QHostAddress::Any);
     void setNodeRpcPort(quint16 port);
     quint16 nodeRpcPort() const;
+    void setWorkerCount(int count); // 0 = one per core, before listen()
+    int workerCount() const;
+    void setUpstreamLimits(int maxConcurrent, int maxQueue, int queueTimeoutMs); // before listen()
+    void setCompression(int minBytes, int level, bool streams); // minBytes < 0 = off, before listen()
+    void setLogBudget(qint64 totalBytes); // all log buffers together, 0 = no limit, before listen()
 
-private slots:
-    void onNewConnection();
+    // HttpRequestHandler
+    void handleRequest(HttpConnection *c, const HttpRequest &r) override;
+    void rejectRequest(HttpConnection *c, int statusCode, const QString &msg) override;
+    bool streamsRequestBody(const HttpRequest &r) const override;
 
 private:
-    struct Request {
-        QByteArray method;                      // "GET", "POST", "OPTIONS", ...
-        QByteArray path;                        // "/start/grinpp" "/start/grinrust"
-        QByteArray httpVersion;                 // "HTTP/1.1"
-        QMap<QByteArray, QByteArray> headers;    // lower-case keys
-        QByteArray body;                        // Body
-        QMap<QByteArray, QByteArray> query;      // Query-Parameter (roh)
-        QString idParam;                        // Path-Parameter /start/{id}, /stop/{id}, /restart/{id}, /logs/{id}
+    // Accepts on the server thread and hands the descriptor to a worker
+    class Listener : public QTcpServer
+    {
+    public:
+        explicit Listener(HttpServer *owner) :
+            m_owner(owner)
+        {
+        }
+
+    protected:
+        void incomingConnection(qintptr socketDescriptor) override;
+
+    private:
+        HttpServer *m_owner;
     };
 
-    // Parsing/IO
-    static bool readHttpRequest(QTcpSocket *s, Request &outReq);
-    static void writeJson(QTcpSocket *s, int statusCode, const QJsonObject &obj);
-    static void writeNoContentCors(QTcpSocket *s);
-    static void writeNotFound(QTcpSocket *s, const QString &msg = QStringLiteral("not found"));
-    static void writeBadRequest(QTcpSocket *s, const QString &msg = QStringLiteral("bad request"));
-    static void writeServerError(QTcpSocket *s, const QString &msg = QStringLiteral("server error"));
-    void writeNoContentCors(QTcpSocket *s, const QByteArray &allowHeaders = QByteArray("Content-Type, Authorization"));
+    void startWorkers();
+    void stopWorkers();
+    void dispatchConnection(qintptr socketDescriptor);
+
+    using Request = HttpRequest;
+
+    // IO
+    static void writeJson(HttpConnection *c, int statusCode, const QJsonObject &obj);
+    static void writeJsonRaw(HttpConnection *c, int statusCode, const QByteArray &payload,
+                             const QByteArray &etag = QByteArray());
+    static void writeNotModified(HttpConnection *c, const QByteArray &etag);
+    static void writeNoContentCors(HttpConnection *c);
+    static void writeNotFound(HttpConnection *c, const QString &msg = QStringLiteral("not found"));
+    static void writeBadRequest(HttpConnection *c, const QString &msg = QStringLiteral("bad request"));
+    static void writeServerError(HttpConnection *c, const QString &msg = QStringLiteral("server error"));
+    static void writeServiceUnavailable(HttpConnection *c, const QString &msg, int retryAfterSec);
+    static void writeMethodNotAllowed(HttpConnection *c, const QByteArray &allow);
+    void writeNoContentCors(HttpConnection *c, const QByteArray &allowHeaders = QByteArray("Content-Type, Authorization"));
 
     // Routing
-    void routeRequest(QTcpSocket *s, const Request &r);
+    void routeRequest(HttpConnection *c, const Request &r);
+    void setupRoutes();
+    void addRoute(const QByteArray &method, const QByteArray &pattern, const HttpRouter::Handler &handler);
 
     // Endpoint handlers
-    void handleOptions(QTcpSocket *s, const Request &r);
-    void handleStatus(QTcpSocket *s);
-    void handleStart(QTcpSocket *s, const Request &r);
-    void handleStop(QTcpSocket *s, const Request &r);
-    void handleRestart(QTcpSocket *s, const Request &r);
-    void handleLogs(QTcpSocket *s, const Request &r);
-    void handleDelete(QTcpSocket *s, const Request &r);
+    void handleOptions(HttpConnection *c, const Request &r);
+    void handleStatus(HttpConnection *c, const Request &r, const QDeadlineTimer &deadline);
+    void handleStart(HttpConnection *c, const Request &r, QByteArrayView nodeId);
+    void handleStop(HttpConnection *c, QByteArrayView nodeId);
+    void handleRestart(HttpConnection *c, const Request &r, QByteArrayView nodeId);
+    void handleLogs(HttpConnection *c, const Request &r, QByteArrayView nodeId, const QDeadlineTimer &deadline);
+    void handleLogRange(HttpConnection *c, const Request &r, INodeController *n, const QByteArray &etag);
+    static void appendLogRecord(QByteArray &out, const INodeController::LogRecord &rec);
+    static bool parseLogFilter(const Request &r, INodeController::LogFilter *filter, QString *error);
+    void handleLogStream(HttpConnection *c, const Request &r, QByteArrayView nodeId);
+    void handleLogCapacity(HttpConnection *c, const Request &r, QByteArrayView nodeId); // empty = all
+    void handleDelete(HttpConnection *c, QByteArrayView nodeId);
+    void handleNodeMetrics(HttpConnection *c, const Request &r, QByteArrayView nodeId);
+    void handleMetrics(HttpConnection *c);
     static bool removeDirRecursively(const QString &path);
 
+    // Node control runs on the thread owning the node's QProcess
+    using NodeCall = std::function<QJsonObject(bool &ok)>;
+    static void callOnNode(HttpConnection *c, INodeController *n, const NodeCall &call);
+
     // Handle Proxy
-    void handleOwnerProxy(QTcpSocket *s, const Request &r);
-    void handleForeignProxy(QTcpSocket *s, const Request &r);
+    void handleOwnerProxy(HttpConnection *c, const Request &r);
+    void handleForeignProxy(HttpConnection *c, const Request &r);
     bool anyNodeRunning() const;
-    void proxyToUrl(QTcpSocket *s, const QString &url, const Request &r, const QString &apiKey = QString());
-    void writeJsonRaw(QTcpSocket *s, int statusCode, const QByteArray &payload);
+    void proxyToUrl(HttpConnection *c, const QString &url, const Request &r, const QString &apiKey = QString(),
+                    UpstreamPool *pool = nullptr);
+    static void startProxy(HttpConnection *c, const QNetworkRequest &req, const QByteArray &body,
+                           const QString &url, UpstreamPool *pool);
     INodeController *firstRunningNode() const;
     QByteArray makeBasicAuthHeader(const QString &password) const;
     QString proxyEndpointUrl(const QString &endpoint) const;
 
+    // Conditional GET (ETag / If-None-Match) and long-poll (?wait=<ms>)
+    QByteArray statusETag() const;
+    static QByteArray logETag(INodeController *n, const Request &r);
+    static QByteArray makeETag(const QVector<quint64> &parts, QByteArrayView extra = QByteArrayView());
+    static bool matchesETag(const Request &r, const QByteArray &etag, QByteArray *matched = nullptr);
+    static QDeadlineTimer waitDeadline(const Request &r);
+
     // Helper functions
-    static QJsonObject parseJsonObject(const QByteArray &body, bool *okOut = nullptr);
-    static QMap<QByteArray, QByteArray> parseQuery(const QByteArray &rawQuery);
-    INodeController *nodeForId(const QString &id) const;
+    static QJsonObject parseJsonObject(QByteArrayView body, bool *okOut = nullptr);
+    INodeController *nodeForId(QByteArrayView id) const;
 
 private:
-    QTcpServer m_server;
-    QMap<QString, INodeController *> m_nodes; // id -> controller
+    Listener m_server;
+    HttpRouter m_router; // read-only after construction
+    int m_optionsMetricsRoute = 0;
+    LogStreamHub m_logStreams;
+    QMap<QString, INodeController *> m_nodes; // id -> controller, read-only after listen()
     quint16 m_nodeRpcPort;
+
+    int m_workerCount;
+    QVector<QThread *> m_threads;
+    QVector<HttpWorker *> m_workers;
+    HttpCompressor::Options m_compression;
+
+    qint64 m_logBudget = 0;
+    QMutex m_logBudgetMutex;    // check and resize as one step
+
+    QMap<QString, UpstreamPool *> m_pools; // node id -> admission control for its RPC port
+    int m_upstreamMaxConcurrent;
+    int m_upstreamMaxQueue;
+    int m_upstreamQueueTimeoutMs;
 };
 
 #endif // HTTPSERVER_H
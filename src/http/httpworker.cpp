@@ -0,0 +1,97 @@
+#include "httpworker.h"
+
+#include <QDebug>
+#include <QNetworkProxy>
+
+#ifdef Q_OS_WIN
+#include <winsock2.h>
+#else
+#include <unistd.h>
+#endif
+
+// Upper bound for one proxied node RPC call without any data
+static const int kUpstreamTransferTimeoutMs = 60000;
+
+/**
+ * @brief HttpWorker::HttpWorker
+ * @param handler
+ * @param compression response compression settings
+ * @param parent
+ */
+HttpWorker::HttpWorker(HttpRequestHandler *handler, const HttpCompressor::Options &compression,
+                       QObject *parent) :
+    QObject(parent),
+    m_handler(handler),
+    m_compression(compression),
+    m_connections(0)
+{
+}
+
+/**
+ * @brief HttpWorker::compression
+ * @return
+ */
+const HttpCompressor::Options &HttpWorker::compression() const
+{
+    return m_compression;
+}
+
+/**
+ * @brief HttpWorker::connectionCount
+ * Safe to call from any thread.
+ * @return
+ */
+int HttpWorker::connectionCount() const
+{
+    return m_connections.loadRelaxed();
+}
+
+/**
+ * @brief HttpWorker::reserveConnection
+ */
+void HttpWorker::reserveConnection()
+{
+    m_connections.ref();
+}
+
+/**
+ * @brief HttpWorker::network
+ * @return
+ */
+QNetworkAccessManager *HttpWorker::network()
+{
+    if (!m_network) {
+        m_network = new QNetworkAccessManager(this);
+        // Node RPC is always local, never route it through a system proxy
+        m_network->setProxy(QNetworkProxy::NoProxy);
+        m_network->setTransferTimeout(kUpstreamTransferTimeoutMs);
+    }
+    return m_network;
+}
+
+/**
+ * @brief HttpWorker::addConnection
+ * Creates the socket on this worker's thread.
+ * @param socketDescriptor
+ */
+void HttpWorker::addConnection(qintptr socketDescriptor)
+{
+    auto *s = new QTcpSocket;
+    if (!s->setSocketDescriptor(socketDescriptor)) {
+        qWarning() << "[http] could not adopt socket:" << s->errorString();
+        delete s;
+        // Still ours, QTcpSocket did not take it over
+#ifdef Q_OS_WIN
+        ::closesocket(SOCKET(socketDescriptor));
+#else
+        ::close(int(socketDescriptor));
+#endif
+        m_connections.deref();
+        return;
+    }
+
+    auto *c = new HttpConnection(s, m_handler, this);
+    connect(c, &QObject::destroyed, this, [this] {
+        m_connections.deref();
+    });
+}
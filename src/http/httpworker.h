@@ -0,0 +1,43 @@
+#ifndef HTTPWORKER_H
+#define HTTPWORKER_H
+
+#include <QObject>
+#include <QAtomicInt>
+#include <QNetworkAccessManager>
+
+#include "httpconnection.h"
+#include "httpcompressor.h"
+
+/**
+ * @brief The HttpWorker class
+ * Lives in its own QThread and owns the connections handed to it by the
+ * accepting HttpServer. Every connection is served entirely on this thread.
+ */
+class HttpWorker : public QObject
+{
+    Q_OBJECT
+public:
+    HttpWorker(HttpRequestHandler *handler, const HttpCompressor::Options &compression,
+               QObject *parent = nullptr);
+
+    int connectionCount() const;
+    // Counts a connection before addConnection() runs, so a burst of
+    // accepts spreads over the workers; safe from any thread
+    void reserveConnection();
+    const HttpCompressor::Options &compression() const;
+
+    // Long-lived upstream client of this worker (keep-alive to the node RPC
+    // port). Only to be used from the worker's own thread.
+    QNetworkAccessManager *network();
+
+public slots:
+    void addConnection(qintptr socketDescriptor);   // after reserveConnection()
+
+private:
+    HttpRequestHandler *m_handler;
+    HttpCompressor::Options m_compression;
+    QAtomicInt m_connections;
+    QNetworkAccessManager *m_network = nullptr;
+};
+
+#endif // HTTPWORKER_H
@@ -0,0 +1,111 @@
+#include "jsonwriter.h"
+
+/**
+ * @brief utf8SequenceLength
+ * Length of the valid UTF-8 sequence at p, 0 if it is malformed.
+ * @param p
+ * @param left bytes available at p
+ * @return
+ */
+static int utf8SequenceLength(const uchar *p, qsizetype left)
+{
+    const uchar c = p[0];
+    int len;
+    uchar lo = 0x80;
+    uchar hi = 0xBF;
+    if (c >= 0xC2 && c <= 0xDF) {
+        len = 2;
+    } else if (c >= 0xE0 && c <= 0xEF) {
+        len = 3;
+        if (c == 0xE0) {
+            lo = 0xA0;  // overlong
+        } else if (c == 0xED) {
+            hi = 0x9F;  // surrogates
+        }
+    } else if (c >= 0xF0 && c <= 0xF4) {
+        len = 4;
+        if (c == 0xF0) {
+            lo = 0x90;
+        } else if (c == 0xF4) {
+            hi = 0x8F;  // > U+10FFFF
+        }
+    } else {
+        return 0;
+    }
+
+    if (left < len || p[1] < lo || p[1] > hi) {
+        return 0;
+    }
+    for (int i = 2; i < len; ++i) {
+        if ((p[i] & 0xC0) != 0x80) {
+            return 0;
+        }
+    }
+    return len;
+}
+
+/**
+ * @brief JsonWriter::appendString
+ * @param out
+ * @param utf8
+ */
+void JsonWriter::appendString(QByteArray &out, QByteArrayView utf8)
+{
+    static const char hex[] = "0123456789abcdef";
+
+    out.reserve(out.size() + utf8.size() + 2);
+    out.append('"');
+
+    const uchar *p = reinterpret_cast<const uchar *>(utf8.data());
+    const qsizetype n = utf8.size();
+    qsizetype run = 0;     // start of bytes that can be copied as they are
+
+    for (qsizetype i = 0; i < n;) {
+        const uchar c = p[i];
+        if (c >= 0x20 && c < 0x80 && c != '"' && c != '\\') {
+            ++i;
+            continue;
+        }
+
+        int len = 1;
+        if (c >= 0x80) {
+            len = utf8SequenceLength(p + i, n - i);
+            if (len > 0) {
+                i += len;
+                continue;
+            }
+        }
+
+        out.append(utf8.data() + run, i - run);
+        switch (c) {
+        case '"':
+            out.append("\\\"", 2);
+            break;
+        case '\\':
+            out.append("\\\\", 2);
+            break;
+        case '\n':
+            out.append("\\n", 2);
+            break;
+        case '\r':
+            out.append("\\r", 2);
+            break;
+        case '\t':
+            out.append("\\t", 2);
+            break;
+        default:
+            if (c < 0x20) {
+                const char esc[6] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xF] };
+                out.append(esc, 6);
+            } else {
+                out.append("\xEF\xBF\xBD", 3); // U+FFFD
+            }
+            break;
+        }
+        i += len;
+        run = i;
+    }
+
+    out.append(utf8.data() + run, n - run);
+    out.append('"');
+}
@@ -0,0 +1,19 @@
+#ifndef JSONWRITER_H
+#define JSONWRITER_H
+
+#include <QByteArray>
+#include <QByteArrayView>
+
+/**
+ * @brief The JsonWriter class
+ * Helpers for writing JSON straight into a byte buffer, for responses built
+ * from raw UTF-8 slices without going through QJsonDocument / QString.
+ */
+class JsonWriter
+{
+public:
+    // Quoted and escaped; invalid UTF-8 becomes U+FFFD
+    static void appendString(QByteArray &out, QByteArrayView utf8);
+};
+
+#endif // JSONWRITER_H
@@ -0,0 +1,93 @@
+#include "linematcher.h"
+
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QMutexLocker>
+
+static const int kCacheSize = 64;
+
+/**
+ * @brief isLiteral
+ * @param pattern
+ * @return true if the pattern has no regex metacharacters
+ */
+static bool isLiteral(const QString &pattern)
+{
+    for (QChar ch : pattern) {
+        if (QStringLiteral("\\^$.|?*+()[]{}").contains(ch)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief LineMatcher::LineMatcher
+ * @param pattern
+ */
+LineMatcher::LineMatcher(const QString &pattern) :
+    m_literal(isLiteral(pattern))
+{
+    if (m_literal) {
+        m_bytes.setPattern(pattern.toUtf8());
+    } else {
+        m_regex.setPattern(pattern);
+        m_regex.optimize();
+    }
+}
+
+/**
+ * @brief LineMatcher::get
+ * @param pattern
+ * @param error
+ * @return
+ */
+QSharedPointer<const LineMatcher> LineMatcher::get(const QString &pattern, QString *error)
+{
+    static QMutex mutex;
+    static QHash<QString, QSharedPointer<const LineMatcher> > cache;
+    static QList<QString> order;     // most recently used last
+
+    {
+        QMutexLocker g(&mutex);
+        auto it = cache.constFind(pattern);
+        if (it != cache.cend()) {
+            order.removeOne(pattern);
+            order.append(pattern);
+            return it.value();
+        }
+    }
+
+    // Compiled outside the lock
+    QSharedPointer<const LineMatcher> m(new LineMatcher(pattern));
+    if (!m->m_literal && !m->m_regex.isValid()) {
+        if (error) {
+            *error = m->m_regex.errorString();
+        }
+        return {};
+    }
+
+    QMutexLocker g(&mutex);
+    if (!cache.contains(pattern)) {
+        if (cache.size() >= kCacheSize) {
+            cache.remove(order.takeFirst());
+        }
+        cache.insert(pattern, m);
+        order.append(pattern);
+    }
+    return m;
+}
+
+/**
+ * @brief LineMatcher::matches
+ * @param line
+ * @return
+ */
+bool LineMatcher::matches(QByteArrayView line) const
+{
+    if (m_literal) {
+        return m_bytes.indexIn(line) >= 0;
+    }
+    return m_regex.match(QString::fromUtf8(line)).hasMatch();
+}
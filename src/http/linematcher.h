@@ -0,0 +1,35 @@
+#ifndef LINEMATCHER_H
+#define LINEMATCHER_H
+
+#include <QByteArray>
+#include <QByteArrayMatcher>
+#include <QByteArrayView>
+#include <QRegularExpression>
+#include <QSharedPointer>
+#include <QString>
+
+/**
+ * @brief The LineMatcher class
+ * Compiled grep= pattern for log lines. Patterns without regex syntax are
+ * searched as plain UTF-8 bytes; others run as QRegularExpression on the
+ * decoded line. Compiled matchers are cached process-wide (LRU), so a UI
+ * paging through results does not recompile per request. Immutable and
+ * usable from any thread.
+ */
+class LineMatcher
+{
+public:
+    // nullptr and error set if the pattern does not compile
+    static QSharedPointer<const LineMatcher> get(const QString &pattern, QString *error = nullptr);
+
+    bool matches(QByteArrayView line) const;
+
+private:
+    explicit LineMatcher(const QString &pattern);
+
+    bool m_literal;
+    QByteArrayMatcher m_bytes;
+    QRegularExpression m_regex;
+};
+
+#endif // LINEMATCHER_H
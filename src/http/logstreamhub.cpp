@@ -0,0 +1,276 @@
+#include "logstreamhub.h"
+#include "httpconnection.h"
+#include "httpworker.h"
+
+// logUpdated() bursts within this window go out as one payload
+static const int kCoalesceMs = 100;
+// Comment line that keeps idle streams (and proxies in between) open
+static const int kHeartbeatMs = 15000;
+// Lines per node and tick; the rest follows on the next tick
+static const int kMaxBatchLines = 5000;
+// History sent on subscribe at most
+static const int kMaxCatchUpLines = 10000;
+// Subscriber that lets this much pile up is dropped
+static const qint64 kMaxPendingBytes = 4 * 1024 * 1024;
+
+/**
+ * @brief LogStreamHub::LogStreamHub
+ * @param parent
+ */
+LogStreamHub::LogStreamHub(QObject *parent) :
+    QObject(parent)
+{
+    m_flushTimer.setSingleShot(true);
+    m_flushTimer.setInterval(kCoalesceMs);
+    connect(&m_flushTimer, &QTimer::timeout, this, &LogStreamHub::flush);
+
+    m_heartbeatTimer.setInterval(kHeartbeatMs);
+    connect(&m_heartbeatTimer, &QTimer::timeout, this, &LogStreamHub::heartbeat);
+}
+
+/**
+ * @brief LogStreamHub::addNode
+ * @param node
+ */
+void LogStreamHub::addNode(INodeController *node)
+{
+    Topic &t = m_topics[node->id()];
+    t.node = node;
+
+    connect(node, &INodeController::logUpdated, this, &LogStreamHub::onLogUpdated);
+}
+
+/**
+ * @brief LogStreamHub::subscribe
+ * @param c
+ * @param node
+ * @param resume
+ * @param resumeAfter
+ * @param backlog
+ */
+void LogStreamHub::subscribe(HttpConnection *c, INodeController *node, bool resume, quint64 resumeAfter, int backlog)
+{
+    const QString id = node->id();
+    HttpWorker *worker = c->worker();
+    const Subscriber sub{ c, QPointer<HttpConnection>(c) };
+
+    // The stream only ends when the client goes away
+    connect(c, &HttpConnection::closed, c, [c] {
+        c->abortResponse();
+    });
+    connect(c, &HttpConnection::closed, this, [this, id, worker, c] {
+        removeSubscriber(id, worker, c);
+    });
+
+    // Queued behind any closed() above, both run on the hub's thread in order
+    QMetaObject::invokeMethod(this, [this, id, worker, sub, resume, resumeAfter, backlog] {
+        addSubscriber(id, worker, sub, resume, resumeAfter, backlog);
+    }, Qt::QueuedConnection);
+}
+
+/**
+ * @brief LogStreamHub::addSubscriber
+ * Sends the catch-up up to the fan-out position, later lines come with
+ * the next flush().
+ * @param id
+ * @param worker
+ * @param sub
+ * @param resume
+ * @param resumeAfter
+ * @param backlog
+ */
+void LogStreamHub::addSubscriber(const QString &id, HttpWorker *worker, const Subscriber &sub,
+                                 bool resume, quint64 resumeAfter, int backlog)
+{
+    auto it = m_topics.find(id);
+    if (it == m_topics.end()) {
+        return;
+    }
+    Topic &t = it.value();
+
+    if (t.count == 0) {
+        // Nobody was listening, start the fan-out at the current end
+        t.sentSeq = t.node->visitLogSince(0, 0, [](quint64, QByteArrayView) {});
+        t.dirty = false;
+    }
+
+    quint64 from = t.sentSeq;
+    if (resume) {
+        from = qMin(resumeAfter, t.sentSeq);
+    } else if (backlog > 0) {
+        from = t.sentSeq > quint64(backlog) ? t.sentSeq - quint64(backlog) : 0;
+    }
+    if (t.sentSeq - from > quint64(kMaxCatchUpLines)) {
+        from = t.sentSeq - quint64(kMaxCatchUpLines);
+    }
+
+    QByteArray payload("retry: 2000\n\n");
+    if (from < t.sentSeq) {
+        payload += formatEvents(t.node, from, int(t.sentSeq - from), nullptr);
+    }
+    post(worker, { sub }, payload);
+
+    t.groups[worker].append(sub);
+    ++t.count;
+    if (!m_heartbeatTimer.isActive()) {
+        m_heartbeatTimer.start();
+    }
+}
+
+/**
+ * @brief LogStreamHub::removeSubscriber
+ * @param id
+ * @param worker
+ * @param key
+ */
+void LogStreamHub::removeSubscriber(const QString &id, HttpWorker *worker, HttpConnection *key)
+{
+    auto it = m_topics.find(id);
+    if (it == m_topics.end()) {
+        return;
+    }
+    Topic &t = it.value();
+
+    auto git = t.groups.find(worker);
+    if (git == t.groups.end()) {
+        return;
+    }
+    QVector<Subscriber> &subs = git.value();
+    for (int i = 0; i < subs.size(); ++i) {
+        if (subs[i].key == key) {
+            subs.removeAt(i);
+            --t.count;
+            break;
+        }
+    }
+    if (subs.isEmpty()) {
+        t.groups.erase(git);
+    }
+}
+
+/**
+ * @brief LogStreamHub::onLogUpdated
+ * @param id
+ */
+void LogStreamHub::onLogUpdated(const QString &id)
+{
+    auto it = m_topics.find(id);
+    if (it == m_topics.end() || it->count == 0) {
+        return;
+    }
+    it->dirty = true;
+    if (!m_flushTimer.isActive()) {
+        m_flushTimer.start();
+    }
+}
+
+/**
+ * @brief LogStreamHub::flush
+ */
+void LogStreamHub::flush()
+{
+    bool more = false;
+    for (auto it = m_topics.begin(); it != m_topics.end(); ++it) {
+        Topic &t = it.value();
+        if (!t.dirty || t.count == 0) {
+            continue;
+        }
+
+        quint64 lastSent = t.sentSeq;
+        const QByteArray payload = formatEvents(t.node, t.sentSeq, kMaxBatchLines, &lastSent);
+        const quint64 newest = t.node->visitLogSince(0, 0, [](quint64, QByteArrayView) {});
+        t.sentSeq = lastSent;
+        t.dirty = lastSent < newest;
+        more = more || t.dirty;
+
+        if (payload.isEmpty()) {
+            continue;
+        }
+        for (auto git = t.groups.cbegin(); git != t.groups.cend(); ++git) {
+            post(git.key(), git.value(), payload);
+        }
+    }
+
+    if (more) {
+        m_flushTimer.start();
+    }
+}
+
+/**
+ * @brief LogStreamHub::heartbeat
+ */
+void LogStreamHub::heartbeat()
+{
+    static const QByteArray ping(":\n\n");
+
+    bool any = false;
+    for (auto it = m_topics.cbegin(); it != m_topics.cend(); ++it) {
+        for (auto git = it->groups.cbegin(); git != it->groups.cend(); ++git) {
+            post(git.key(), git.value(), ping);
+            any = true;
+        }
+    }
+    if (!any) {
+        m_heartbeatTimer.stop();
+    }
+}
+
+/**
+ * @brief LogStreamHub::formatEvents
+ * One event per line: "id: <seq>" and "data: <line>". Lines lost to the
+ * ring wrapping are announced as a "dropped" event with their count.
+ * @param node
+ * @param afterSeq
+ * @param limit
+ * @param lastSent receives the seq of the last line written
+ * @return
+ */
+QByteArray LogStreamHub::formatEvents(INodeController *node, quint64 afterSeq, int limit, quint64 *lastSent)
+{
+    QByteArray out;
+    quint64 last = afterSeq;
+    quint64 firstSeq = 0;
+
+    node->visitLogSince(afterSeq, limit, [&out, &last](quint64 seq, QByteArrayView line) {
+        out += "id: ";
+        out += QByteArray::number(seq);
+        out += "\ndata: ";
+        out.append(line.data(), line.size());
+        out += "\n\n";
+        last = seq;
+    }, &firstSeq);
+
+    if (afterSeq + 1 < firstSeq && last > afterSeq) {
+        const QByteArray dropped = "event: dropped\ndata: " + QByteArray::number(firstSeq - afterSeq - 1) + "\n\n";
+        out.prepend(dropped);
+    }
+    if (lastSent) {
+        *lastSent = last;
+    }
+    return out;
+}
+
+/**
+ * @brief LogStreamHub::post
+ * One queued call per worker; the payload is shared, not copied.
+ * @param worker
+ * @param subs
+ * @param payload
+ */
+void LogStreamHub::post(HttpWorker *worker, const QVector<Subscriber> &subs, const QByteArray &payload)
+{
+    QMetaObject::invokeMethod(worker, [subs, payload] {
+        for (const Subscriber &s : subs) {
+            HttpConnection *c = s.conn.data();
+            if (!c || c->isClosed()) {
+                continue;
+            }
+            if (c->pendingBytes() > kMaxPendingBytes) {
+                // Too slow to keep up, the client may reconnect with Last-Event-ID
+                c->abortResponse();
+                continue;
+            }
+            c->writeChunk(payload);
+        }
+    }, Qt::QueuedConnection);
+}
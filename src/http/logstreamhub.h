@@ -0,0 +1,68 @@
+#ifndef LOGSTREAMHUB_H
+#define LOGSTREAMHUB_H
+
+#include <QObject>
+#include <QHash>
+#include <QVector>
+#include <QPointer>
+#include <QTimer>
+#include <QString>
+#include <QByteArray>
+
+#include "inodecontroller.h"
+
+class HttpConnection;
+class HttpWorker;
+
+/**
+ * @brief The LogStreamHub class
+ * Fan-out of new log lines to Server-Sent Events subscribers
+ * (GET /logs/{id}/stream). logUpdated() notifications are coalesced; per
+ * tick the new lines of a node are read and serialized once, and the same
+ * payload is posted once per worker thread, which writes it to all of its
+ * subscribers. Lives on the thread of the HttpServer.
+ */
+class LogStreamHub : public QObject
+{
+    Q_OBJECT
+public:
+    explicit LogStreamHub(QObject *parent = nullptr);
+
+    void addNode(INodeController *node); // before listen()
+
+    // Called on the connection's worker thread after the event-stream
+    // response has begun. resumeAfter: Last-Event-ID, backlog: lines of
+    // history to send first if not resuming.
+    void subscribe(HttpConnection *c, INodeController *node, bool resume, quint64 resumeAfter, int backlog);
+
+private slots:
+    void onLogUpdated(const QString &id);
+    void flush();
+    void heartbeat();
+
+private:
+    struct Subscriber {
+        HttpConnection *key;    // identity only, never dereferenced here
+        QPointer<HttpConnection> conn;
+    };
+
+    struct Topic {
+        INodeController *node = nullptr;
+        quint64 sentSeq = 0;    // newest line already fanned out
+        bool dirty = false;
+        int count = 0;
+        QHash<HttpWorker *, QVector<Subscriber>> groups;
+    };
+
+    void addSubscriber(const QString &id, HttpWorker *worker, const Subscriber &sub,
+                       bool resume, quint64 resumeAfter, int backlog);
+    void removeSubscriber(const QString &id, HttpWorker *worker, HttpConnection *key);
+    static QByteArray formatEvents(INodeController *node, quint64 afterSeq, int limit, quint64 *lastSent);
+    static void post(HttpWorker *worker, const QVector<Subscriber> &subs, const QByteArray &payload);
+
+    QHash<QString, Topic> m_topics;
+    QTimer m_flushTimer;
+    QTimer m_heartbeatTimer;
+};
+
+#endif // LOGSTREAMHUB_H
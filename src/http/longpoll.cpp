@@ -0,0 +1,69 @@
+#include "longpoll.h"
+#include "httpconnection.h"
+
+/**
+ * @brief LongPoll::LongPoll
+ * @param c
+ * @param retry
+ */
+LongPoll::LongPoll(HttpConnection *c, const Retry &retry) :
+    QObject(c),
+    m_timer(this),
+    m_retry(retry)
+{
+    m_timer.setSingleShot(true);
+    connect(&m_timer, &QTimer::timeout, this, &LongPoll::fire);
+
+    connect(c, &HttpConnection::closed, this, [this, c] {
+        m_done = true;
+        c->abortResponse();
+        deleteLater();
+    });
+}
+
+/**
+ * @brief LongPoll::start
+ * @param c
+ * @param nodes
+ * @param watch only this signal wakes the poll, the other one cannot
+ *        change the answer
+ * @param deadline
+ * @param retry
+ */
+void LongPoll::start(HttpConnection *c, const QList<INodeController *> &nodes, Watch watch,
+                     const QDeadlineTimer &deadline, const Retry &retry)
+{
+    auto *poll = new LongPoll(c, retry);
+
+    // The signals come from the node's thread and are queued to this one
+    for (INodeController *n : nodes) {
+        if (watch == Watch::Log) {
+            connect(n, &INodeController::logUpdated, poll, &LongPoll::fire);
+        } else {
+            connect(n, &INodeController::statusChanged, poll, &LongPoll::fire);
+        }
+    }
+
+    poll->m_timer.start(int(qMax<qint64>(0, deadline.remainingTime())));
+}
+
+/**
+ * @brief LongPoll::fire
+ */
+void LongPoll::fire()
+{
+    if (m_done) {
+        return;
+    }
+    m_done = true;
+    m_timer.stop();
+    deleteLater();
+
+    // The wait is not request latency, only the answer after it
+    if (auto *c = qobject_cast<HttpConnection *>(parent())) {
+        c->restartRequestTimer();
+    }
+
+    // Re-runs the handler, which answers or waits again
+    m_retry();
+}
@@ -0,0 +1,48 @@
+#ifndef LONGPOLL_H
+#define LONGPOLL_H
+
+#include <QObject>
+#include <QTimer>
+#include <QDeadlineTimer>
+#include <QList>
+
+#include <functional>
+
+#include "inodecontroller.h"
+
+class HttpConnection;
+
+/**
+ * @brief The LongPoll class
+ * Holds one request (GET ...?wait=<ms>) until one of the watched nodes
+ * reports a change (statusChanged or logUpdated) or the deadline passes,
+ * then calls retry once on the connection's thread. Child of the
+ * connection; a client going away ends the wait without retry.
+ */
+class LongPoll : public QObject
+{
+    Q_OBJECT
+public:
+    using Retry = std::function<void()>;
+
+    enum class Watch {
+        Status,     // statusChanged
+        Log         // logUpdated
+    };
+
+    // Called on the connection's thread, instead of sending a response
+    static void start(HttpConnection *c, const QList<INodeController *> &nodes, Watch watch,
+                      const QDeadlineTimer &deadline, const Retry &retry);
+
+private slots:
+    void fire();
+
+private:
+    LongPoll(HttpConnection *c, const Retry &retry);
+
+    QTimer m_timer;
+    Retry m_retry;
+    bool m_done = false;
+};
+
+#endif // LONGPOLL_H
@@ -0,0 +1,185 @@
+#include "proxyrelay.h"
+#include "httpresponse.h"
+
+#include <QDebug>
+
+// Stop reading upstream while this much is queued for the client
+static const qint64 kHighWatermark = 256 * 1024;
+// Size of one chunk taken from the reply
+static const qint64 kChunkSize = 64 * 1024;
+
+/**
+ * @brief isTransportError
+ * Connection level failure (refused, closed, timeout, canceled, proxy).
+ * HTTP error statuses of the node still carry a body that is relayed.
+ * @param e
+ * @return
+ */
+static bool isTransportError(QNetworkReply::NetworkError e)
+{
+    return e != QNetworkReply::NoError && e < QNetworkReply::ContentAccessDenied;
+}
+
+/**
+ * @brief ProxyRelay::ProxyRelay
+ * @param c
+ * @param reply
+ * @param url
+ * @param pool slot held for this call, released on destruction
+ */
+ProxyRelay::ProxyRelay(HttpConnection *c, QNetworkReply *reply, const QString &url, UpstreamPool *pool) :
+    QObject(reply),
+    m_conn(c),
+    m_reply(reply),
+    m_url(url),
+    m_pool(pool),
+    m_endpoint(url.endsWith(QLatin1String("/foreign")) ? HttpMetrics::Upstream::Foreign
+                                                       : HttpMetrics::Upstream::Owner)
+{
+    m_elapsed.start();
+
+    // Upstream socket is only read as fast as the client takes the data
+    m_reply->setReadBufferSize(kHighWatermark);
+
+    connect(m_reply, &QNetworkReply::metaDataChanged, this, &ProxyRelay::onMetaDataChanged);
+    connect(m_reply, &QNetworkReply::readyRead, this, &ProxyRelay::onReadyRead);
+    connect(m_reply, &QNetworkReply::finished, this, &ProxyRelay::onFinished);
+
+    connect(c, &HttpConnection::drained, this, &ProxyRelay::pump);
+    // Client gone: no need to wait for the node
+    connect(c, &HttpConnection::closed, m_reply, &QNetworkReply::abort);
+}
+
+/**
+ * @brief ProxyRelay::~ProxyRelay
+ */
+ProxyRelay::~ProxyRelay()
+{
+    if (m_pool) {
+        m_pool->release();
+    }
+}
+
+/**
+ * @brief ProxyRelay::onMetaDataChanged
+ */
+void ProxyRelay::onMetaDataChanged()
+{
+    begin();
+}
+
+/**
+ * @brief ProxyRelay::onReadyRead
+ */
+void ProxyRelay::onReadyRead()
+{
+    if (begin()) {
+        pump();
+    }
+}
+
+/**
+ * @brief ProxyRelay::onFinished
+ */
+void ProxyRelay::onFinished()
+{
+    m_upstreamDone = true;
+    const int upstreamStatus = isTransportError(m_reply->error())
+        ? 0 : m_reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    HttpMetrics::instance()->observeUpstream(m_endpoint, upstreamStatus, m_elapsed.nsecsElapsed());
+
+    if (!m_begun) {
+        const int status = m_reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+        if (status == 0) {
+            qWarning() << "[proxy]" << m_url << "network error:"
+                       << m_reply->error() << m_reply->errorString();
+
+            const QByteArray payload = m_reply->readAll();
+            if (m_conn) {
+                HttpResponse resp(500);
+                resp.setContentLength(payload.size());
+                m_conn->sendResponse(resp, payload);
+            }
+            m_done = true;
+            m_reply->deleteLater();
+            return;
+        }
+        begin();
+    }
+
+    if (isTransportError(m_reply->error())) {
+        // Status already sent, only a truncated body can signal the failure
+        qWarning() << "[proxy]" << m_url << "upstream failed mid-response:"
+                   << m_reply->error() << m_reply->errorString();
+        if (m_conn) {
+            m_conn->abortResponse();
+        }
+        m_done = true;
+        m_reply->deleteLater();
+        return;
+    }
+
+    pump();
+}
+
+/**
+ * @brief ProxyRelay::begin
+ * Sends the response head once the upstream status is known.
+ * @return
+ */
+bool ProxyRelay::begin()
+{
+    if (m_begun) {
+        return true;
+    }
+
+    const int status = m_reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if (status == 0) {
+        return false;
+    }
+
+    m_begun = true;
+    if (m_conn) {
+        m_conn->beginResponse(HttpResponse(status));
+    }
+    return true;
+}
+
+/**
+ * @brief ProxyRelay::pump
+ */
+void ProxyRelay::pump()
+{
+    if (!m_begun || m_done) {
+        return;
+    }
+
+    if (!m_conn) {
+        // Worker shut down under us, just drain the reply
+        m_reply->readAll();
+        tryFinish();
+        return;
+    }
+
+    while (m_reply->bytesAvailable() > 0 && m_conn->pendingBytes() < kHighWatermark) {
+        m_conn->writeChunk(m_reply->read(kChunkSize));
+    }
+
+    tryFinish();
+}
+
+/**
+ * @brief ProxyRelay::tryFinish
+ */
+void ProxyRelay::tryFinish()
+{
+    if (!m_upstreamDone || m_reply->bytesAvailable() > 0 || m_done) {
+        return;
+    }
+
+    m_done = true;
+    if (m_conn) {
+        m_conn->endResponse();
+    }
+    m_reply->deleteLater();
+}
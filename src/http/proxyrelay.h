@@ -0,0 +1,48 @@
+#ifndef PROXYRELAY_H
+#define PROXYRELAY_H
+
+#include <QObject>
+#include <QPointer>
+#include <QNetworkReply>
+#include <QString>
+#include <QElapsedTimer>
+
+#include "httpconnection.h"
+#include "upstreampool.h"
+#include "httpmetrics.h"
+
+/**
+ * @brief The ProxyRelay class
+ * Streams one upstream node RPC reply to the client as it arrives. Reading
+ * from the reply pauses while the client's send buffer is above the high
+ * watermark and resumes on HttpConnection::drained(). Owned by the reply.
+ */
+class ProxyRelay : public QObject
+{
+    Q_OBJECT
+public:
+    ProxyRelay(HttpConnection *c, QNetworkReply *reply, const QString &url, UpstreamPool *pool = nullptr);
+    ~ProxyRelay() override;
+
+private slots:
+    void onMetaDataChanged();
+    void onReadyRead();
+    void onFinished();
+
+private:
+    bool begin();
+    void pump();
+    void tryFinish();
+
+    QPointer<HttpConnection> m_conn;
+    QNetworkReply *m_reply;
+    QString m_url;
+    UpstreamPool *m_pool;
+    HttpMetrics::Upstream m_endpoint;
+    QElapsedTimer m_elapsed;    // since the call went out
+    bool m_begun = false;
+    bool m_upstreamDone = false;
+    bool m_done = false;
+};
+
+#endif // PROXYRELAY_H
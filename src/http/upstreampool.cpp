@@ -0,0 +1,138 @@
+#include "upstreampool.h"
+
+/**
+ * @brief UpstreamPool::UpstreamPool
+ * @param name node id
+ * @param maxConcurrent
+ * @param maxQueue
+ * @param queueTimeoutMs
+ */
+UpstreamPool::UpstreamPool(const QString &name, int maxConcurrent, int maxQueue, int queueTimeoutMs) :
+    m_name(name),
+    m_maxConcurrent(qMax(1, maxConcurrent)),
+    m_maxQueue(qMax(0, maxQueue)),
+    m_queueTimeoutMs(qMax(1, queueTimeoutMs))
+{
+}
+
+/**
+ * @brief UpstreamPool::acquire
+ * @param context object on the caller's thread, must outlive the wait
+ * @param onGranted
+ * @param ticket
+ * @return
+ */
+UpstreamPool::Admission UpstreamPool::acquire(QObject *context, const std::function<void()> &onGranted, quint64 *ticket)
+{
+    QMutexLocker g(&m_mutex);
+
+    if (m_inFlight < m_maxConcurrent) {
+        ++m_inFlight;
+        ++m_granted;
+        return Admission::Granted;
+    }
+
+    if (m_queue.size() >= m_maxQueue) {
+        ++m_rejected;
+        return Admission::Rejected;
+    }
+
+    Waiter w;
+    w.ticket = m_nextTicket++;
+    w.context = context;
+    w.onGranted = onGranted;
+    w.waiting.start();
+    m_queue.append(w);
+
+    ++m_queuedTotal;
+
+    if (ticket) {
+        *ticket = w.ticket;
+    }
+    return Admission::Queued;
+}
+
+/**
+ * @brief UpstreamPool::cancel
+ * Removes a waiting call, at its deadline or when its client went away.
+ * @param ticket
+ * @param reason
+ * @return
+ */
+bool UpstreamPool::cancel(quint64 ticket, CancelReason reason)
+{
+    QMutexLocker g(&m_mutex);
+    for (int i = 0; i < m_queue.size(); ++i) {
+        if (m_queue.at(i).ticket == ticket) {
+            m_queue.removeAt(i);
+            if (reason == CancelReason::Timeout) {
+                ++m_timedOut;
+            } else {
+                ++m_abandoned;
+            }
+                    return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief UpstreamPool::release
+ * Hands the slot straight to the oldest waiter, if any.
+ */
+void UpstreamPool::release()
+{
+    QMutexLocker g(&m_mutex);
+
+    if (m_queue.isEmpty()) {
+        m_inFlight = qMax(0, m_inFlight - 1);
+        return;
+    }
+
+    const Waiter w = m_queue.takeFirst();
+    ++m_granted;
+    m_queueWaitMsTotal += w.waiting.elapsed();
+    g.unlock();
+
+    QMetaObject::invokeMethod(w.context, w.onGranted, Qt::QueuedConnection);
+}
+
+/**
+ * @brief UpstreamPool::name
+ * @return
+ */
+QString UpstreamPool::name() const
+{
+    return m_name;
+}
+
+/**
+ * @brief UpstreamPool::queueTimeoutMs
+ * @return
+ */
+int UpstreamPool::queueTimeoutMs() const
+{
+    return m_queueTimeoutMs;
+}
+
+/**
+ * @brief UpstreamPool::stats
+ * @return
+ */
+UpstreamPool::Stats UpstreamPool::stats() const
+{
+    QMutexLocker g(&m_mutex);
+
+    Stats st;
+    st.maxConcurrent = m_maxConcurrent;
+    st.maxQueue = m_maxQueue;
+    st.inFlight = m_inFlight;
+    st.queued = int(m_queue.size());
+    st.granted = m_granted;
+    st.queuedTotal = m_queuedTotal;
+    st.rejected = m_rejected;
+    st.timedOut = m_timedOut;
+    st.abandoned = m_abandoned;
+    st.queueWaitMsTotal = m_queueWaitMsTotal;
+    return st;
+}
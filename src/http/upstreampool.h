@@ -0,0 +1,85 @@
+#ifndef UPSTREAMPOOL_H
+#define UPSTREAMPOOL_H
+
+#include <QObject>
+#include <QMutex>
+#include <QList>
+#include <QString>
+#include <QElapsedTimer>
+
+#include <functional>
+
+/**
+ * @brief The UpstreamPool class
+ * Admission limiter for the RPC port of one node, shared by all workers.
+ * At most maxConcurrent proxied calls run at once; it does not own or pin
+ * connections (each worker's QNetworkAccessManager opens up to 6 per
+ * host). Further calls wait in a FIFO queue of bounded length; a full
+ * queue fails fast. Thread-safe.
+ */
+class UpstreamPool
+{
+public:
+    enum class Admission {
+        Granted,    // slot taken, call may start right away
+        Queued,     // onGranted is posted to context once a slot frees up
+        Rejected    // queue full
+    };
+
+    enum class CancelReason {
+        Timeout,    // counted in Stats::timedOut
+        ClientGone  // counted in Stats::abandoned
+    };
+
+    // Counters since the controller started, for /metrics
+    struct Stats {
+        int maxConcurrent = 0;
+        int maxQueue = 0;
+        int inFlight = 0;
+        int queued = 0;
+        quint64 granted = 0;
+        quint64 queuedTotal = 0;
+        quint64 rejected = 0;
+        quint64 timedOut = 0;
+        quint64 abandoned = 0;
+        qint64 queueWaitMsTotal = 0;
+    };
+
+    UpstreamPool(const QString &name, int maxConcurrent, int maxQueue, int queueTimeoutMs);
+
+    Admission acquire(QObject *context, const std::function<void()> &onGranted, quint64 *ticket);
+    bool cancel(quint64 ticket, CancelReason reason);   // true if the ticket was still waiting
+    void release();
+
+    QString name() const;
+    int queueTimeoutMs() const;
+    Stats stats() const;
+
+private:
+    struct Waiter {
+        quint64 ticket;
+        QObject *context;
+        std::function<void()> onGranted;
+        QElapsedTimer waiting;
+    };
+
+    const QString m_name;
+    const int m_maxConcurrent;
+    const int m_maxQueue;
+    const int m_queueTimeoutMs;
+
+    mutable QMutex m_mutex;
+    QList<Waiter> m_queue;
+    quint64 m_nextTicket = 1;
+    int m_inFlight = 0;
+
+    // Statistics
+    quint64 m_granted = 0;
+    quint64 m_queuedTotal = 0;
+    quint64 m_rejected = 0;
+    quint64 m_timedOut = 0;
+    quint64 m_abandoned = 0;
+    qint64 m_queueWaitMsTotal = 0;
+};
+
+#endif // UPSTREAMPOOL_H
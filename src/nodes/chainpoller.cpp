@@ -0,0 +1,319 @@
+#include "chainpoller.h"
+#include "jsonwriter.h"
+
+#include <QDateTime>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QNetworkRequest>
+#include <QUrl>
+
+/**
+ * @brief ChainPoller::ChainPoller
+ * @param parent
+ */
+ChainPoller::ChainPoller(QObject *parent) :
+    QObject(parent),
+    m_timer(this)
+{
+    connect(&m_timer, &QTimer::timeout, this, &ChainPoller::poll);
+}
+
+/**
+ * @brief ChainPoller::setPort
+ * @param port
+ */
+void ChainPoller::setPort(quint16 port)
+{
+    m_port = port;
+}
+
+/**
+ * @brief ChainPoller::setInterval
+ * @param ms
+ */
+void ChainPoller::setInterval(int ms)
+{
+    m_intervalMs = qMax(0, ms);
+    if (m_intervalMs == 0) {
+        stop();
+        return;
+    }
+    m_timer.setInterval(m_intervalMs);
+}
+
+/**
+ * @brief ChainPoller::interval
+ * @return
+ */
+int ChainPoller::interval() const
+{
+    return m_intervalMs;
+}
+
+/**
+ * @brief ChainPoller::setApiKeys
+ * @param owner
+ * @param foreign
+ */
+void ChainPoller::setApiKeys(const KeyProvider &owner, const KeyProvider &foreign)
+{
+    m_ownerKey = owner;
+    m_foreignKey = foreign;
+}
+
+/**
+ * @brief ChainPoller::start
+ * The node's API comes up a while after the process; until then the
+ * calls fail and lastError says so.
+ */
+void ChainPoller::start()
+{
+    if (m_intervalMs <= 0) {
+        return;
+    }
+    if (!m_network) {
+        m_network = new QNetworkAccessManager(this);
+    }
+    {
+        QMutexLocker g(&m_mutex);
+        m_active = true;
+    }
+    m_timer.start();
+    emit updated();
+}
+
+/**
+ * @brief ChainPoller::stop
+ */
+void ChainPoller::stop()
+{
+    m_timer.stop();
+    abortPending();
+
+    QMutexLocker g(&m_mutex);
+    if (!m_active) {
+        return;
+    }
+    m_active = false;
+    m_tipHeight = 0;
+    m_tipHash.clear();
+    m_tipAtMs = 0;
+    m_syncStatus.clear();
+    m_syncAtMs = 0;
+    m_peerCount = 0;
+    m_peersAtMs = 0;
+    m_lastError.clear();
+    g.unlock();
+
+    emit updated();
+}
+
+/**
+ * @brief ChainPoller::abortPending
+ */
+void ChainPoller::abortPending()
+{
+    for (QPointer<QNetworkReply> &reply : m_pending) {
+        if (reply) {
+            reply->disconnect(this);
+            reply->abort();
+            reply->deleteLater();
+        }
+        reply = nullptr;
+    }
+}
+
+/**
+ * @brief ChainPoller::poll
+ */
+void ChainPoller::poll()
+{
+    for (int call = 0; call < CallCount; ++call) {
+        // A slow node is not asked again before it answered
+        if (!m_pending[call]) {
+            send(Call(call));
+        }
+    }
+}
+
+/**
+ * @brief ChainPoller::send
+ * @param call
+ */
+void ChainPoller::send(Call call)
+{
+    static const char *const kMethods[CallCount] = { "get_status", "get_tip", "get_connected_peers" };
+
+    const bool foreign = (call == Tip);
+    const QUrl url(QStringLiteral("http://127.0.0.1:%1/v2/%2")
+                   .arg(m_port)
+                   .arg(foreign ? QStringLiteral("foreign") : QStringLiteral("owner")));
+
+    QNetworkRequest req(url);
+    req.setHeader(QNetworkRequest::ContentTypeHeader, QByteArrayLiteral("application/json"));
+    req.setTransferTimeout(qMax(1000, m_intervalMs));
+
+    // user ist immer "grin"; Grin++ hat keine Secrets
+    const QString key = foreign ? (m_foreignKey ? m_foreignKey() : QString())
+                                : (m_ownerKey ? m_ownerKey() : QString());
+    if (!key.isEmpty()) {
+        req.setRawHeader("Authorization", "Basic " + (QByteArrayLiteral("grin:") + key.toUtf8()).toBase64());
+    }
+
+    QByteArray body("{\"jsonrpc\":\"2.0\",\"id\":1,\"method\":\"");
+    body += kMethods[call];
+    body += "\",\"params\":[]}";
+
+    QNetworkReply *reply = m_network->post(req, body);
+    m_pending[call] = reply;
+    connect(reply, &QNetworkReply::finished, this, [this, call, reply] {
+        onReply(call, reply);
+    });
+}
+
+/**
+ * @brief ChainPoller::unwrapResult
+ * JSON-RPC envelope of the v2 APIs: {"result": {"Ok": ...}} or
+ * {"result": {"Err": ...}} or {"error": {...}}.
+ * @param body
+ * @param error
+ * @return the Ok value, undefined on error
+ */
+QJsonValue ChainPoller::unwrapResult(const QByteArray &body, QString *error)
+{
+    QJsonParseError pe;
+    const QJsonDocument doc = QJsonDocument::fromJson(body, &pe);
+    if (pe.error != QJsonParseError::NoError || !doc.isObject()) {
+        *error = QStringLiteral("invalid JSON-RPC reply");
+        return QJsonValue(QJsonValue::Undefined);
+    }
+
+    const QJsonObject root = doc.object();
+    if (root.contains("error")) {
+        *error = root.value("error").toObject().value("message").toString(QStringLiteral("JSON-RPC error"));
+        return QJsonValue(QJsonValue::Undefined);
+    }
+
+    const QJsonValue result = root.value("result");
+    if (result.isObject()) {
+        const QJsonObject o = result.toObject();
+        if (o.contains("Ok")) {
+            return o.value("Ok");
+        }
+        if (o.contains("Err")) {
+            *error = QString::fromUtf8(QJsonDocument(QJsonObject{ { "Err", o.value("Err") } })
+                                       .toJson(QJsonDocument::Compact));
+            return QJsonValue(QJsonValue::Undefined);
+        }
+    }
+    return result;
+}
+
+/**
+ * @brief ChainPoller::onReply
+ * @param call
+ * @param reply
+ */
+void ChainPoller::onReply(Call call, QNetworkReply *reply)
+{
+    reply->deleteLater();
+    if (m_pending[call] == reply) {
+        m_pending[call] = nullptr;
+    }
+
+    QString error;
+    QJsonValue value(QJsonValue::Undefined);
+    if (reply->error() != QNetworkReply::NoError) {
+        error = reply->errorString();
+    } else {
+        value = unwrapResult(reply->readAll(), &error);
+    }
+
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    QMutexLocker g(&m_mutex);
+    if (!m_active) {
+        return;
+    }
+
+    if (value.isUndefined()) {
+        if (error == m_lastError) {
+            return;
+        }
+        m_lastError = error;
+    } else {
+        const QJsonObject o = value.toObject();
+        switch (call) {
+        case Status:
+            m_syncStatus = o.value("sync_status").toString().toUtf8();
+            m_syncAtMs = now;
+            break;
+        case Tip:
+            m_tipHeight = o.value("height").toInteger();
+            m_tipHash = o.value("last_block_pushed").toString().toUtf8();
+            m_tipAtMs = now;
+            break;
+        case Peers:
+            m_peerCount = int(value.toArray().size());
+            m_peersAtMs = now;
+            break;
+        case CallCount:
+            break;
+        }
+        m_lastError.clear();
+    }
+    g.unlock();
+
+    emit updated();
+}
+
+/**
+ * @brief ChainPoller::appendJson
+ * Sample times are epoch ms, clients compute the age themselves; the
+ * output only changes when a sample lands (updated()).
+ * @param out
+ */
+void ChainPoller::appendJson(QByteArray &out) const
+{
+    QMutexLocker g(&m_mutex);
+    if (!m_active) {
+        out += "\"chain\":null";
+        return;
+    }
+
+    out += "\"chain\":{\"intervalMs\":" + QByteArray::number(m_intervalMs);
+
+    out += ",\"tip\":";
+    if (m_tipAtMs) {
+        out += "{\"height\":" + QByteArray::number(m_tipHeight) + ",\"hash\":";
+        JsonWriter::appendString(out, m_tipHash);
+        out += ",\"sampledAtMs\":" + QByteArray::number(m_tipAtMs) + '}';
+    } else {
+        out += "null";
+    }
+
+    out += ",\"sync\":";
+    if (m_syncAtMs) {
+        out += "{\"status\":";
+        JsonWriter::appendString(out, m_syncStatus);
+        out += ",\"sampledAtMs\":" + QByteArray::number(m_syncAtMs) + '}';
+    } else {
+        out += "null";
+    }
+
+    out += ",\"peers\":";
+    if (m_peersAtMs) {
+        out += "{\"count\":" + QByteArray::number(m_peerCount);
+        out += ",\"sampledAtMs\":" + QByteArray::number(m_peersAtMs) + '}';
+    } else {
+        out += "null";
+    }
+
+    out += ",\"lastError\":";
+    if (m_lastError.isEmpty()) {
+        out += "null";
+    } else {
+        JsonWriter::appendString(out, m_lastError.toUtf8());
+    }
+    out += '}';
+}
@@ -0,0 +1,81 @@
+#ifndef CHAINPOLLER_H
+#define CHAINPOLLER_H
+
+#include <QObject>
+#include <QTimer>
+#include <QMutex>
+#include <QPointer>
+#include <QByteArray>
+#include <QString>
+#include <QJsonValue>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+
+#include <functional>
+
+/**
+ * @brief The ChainPoller class
+ * Samples get_status, get_connected_peers (owner API) and get_tip (foreign
+ * API) of a running node at a fixed interval over its RPC port, so the
+ * status can report tip height, sync state and peer count without every
+ * client asking the node. At most one call per method is in flight.
+ * Lives on the node's thread; appendJson() may be called from any thread.
+ */
+class ChainPoller : public QObject
+{
+    Q_OBJECT
+public:
+    using KeyProvider = std::function<QString()>;
+
+    explicit ChainPoller(QObject *parent = nullptr);
+
+    void setPort(quint16 port);             // node RPC port on 127.0.0.1
+    void setInterval(int ms);               // 0 = off
+    int interval() const;
+    void setApiKeys(const KeyProvider &owner, const KeyProvider &foreign);
+
+    void start();   // node started
+    void stop();    // node stopped, forgets the samples
+
+    // "chain": {...} or "chain": null while not polling
+    void appendJson(QByteArray &out) const;
+
+signals:
+    void updated();     // sample or error changed
+
+private:
+    enum Call {
+        Status,
+        Tip,
+        Peers,
+        CallCount
+    };
+
+    void poll();
+    void send(Call call);
+    void onReply(Call call, QNetworkReply *reply);
+    void abortPending();
+    static QJsonValue unwrapResult(const QByteArray &body, QString *error);
+
+    QNetworkAccessManager *m_network = nullptr;    // created on first start()
+    QTimer m_timer;
+    quint16 m_port = 3413;
+    int m_intervalMs = 0;
+    KeyProvider m_ownerKey;
+    KeyProvider m_foreignKey;
+    QPointer<QNetworkReply> m_pending[CallCount];
+
+    // Read by the HTTP workers
+    mutable QMutex m_mutex;
+    bool m_active = false;
+    qint64 m_tipHeight = 0;
+    QByteArray m_tipHash;
+    qint64 m_tipAtMs = 0;       // epoch ms, 0 = no sample yet
+    QByteArray m_syncStatus;
+    qint64 m_syncAtMs = 0;
+    int m_peerCount = 0;
+    qint64 m_peersAtMs = 0;
+    QString m_lastError;
+};
+
+#endif // CHAINPOLLER_H
@@ -29,9 +29,10 @@ GrinPPNode::GrinPPNode(QObject *parent) :
     NodeProc("grinpp",
              qEnvironmentVariable("GRINPP_BIN"),
              qEnvironmentVariable("GRINPP_ARGS").split(',', Qt::SkipEmptyParts),
-             5000,
+             kDefaultLogCapacityBytes,
              parent)
 {
+    setLogParser(new GrinPPLogParser);
 }
 
 void GrinPPNode::beforeStart(QStringList &args)
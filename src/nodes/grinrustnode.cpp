@@ -9,9 +9,10 @@ GrinRustNode::GrinRustNode(QObject *parent) :
     NodeProc("rust",
              qEnvironmentVariable("GRIN_RUST_BIN"),
              qEnvironmentVariable("GRIN_RUST_ARGS").split(',', Qt::SkipEmptyParts),
-             5000,
+             kDefaultLogCapacityBytes,
              parent)
 {
+    setLogParser(new GrinRustLogParser);
 }
 
 void GrinRustNode::beforeStart(QStringList &args)
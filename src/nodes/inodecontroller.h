@@ -1,17 +1,30 @@
 #ifndef INODECONTROLLER_H
 #define INODECONTROLLER_H
 
+#include <QObject>
 #include <QString>
 #include <QStringList>
 #include <QJsonObject>
+#include <QByteArray>
+#include <QByteArrayView>
+
+#include <functional>
 
 /**
  * @brief The INodeController class Interface
+ * QObject so that the HTTP side can connect to the change signals with
+ * typed connects; calls that touch the process run on the node's thread.
  */
-class INodeController
+class INodeController : public QObject
 {
+    Q_OBJECT
 public:
-    virtual ~INodeController() = default;
+    explicit INodeController(QObject *parent = nullptr) :
+        QObject(parent)
+    {
+    }
+
+    ~INodeController() override = default;
 
     virtual bool start(const QStringList &extraArgs = {}) = 0;
     virtual bool stop(int gracefulMs = 4000) = 0;
@@ -24,8 +37,80 @@ public:
     virtual void setDefaultArgs(const QStringList &args) = 0;
 
     virtual QJsonObject statusJson() const = 0;
+    // Same as statusJson(), serialized; built from a snapshot that changes
+    // only on events, so it costs no file access and little JSON work
+    virtual QByteArray statusBytes() const = 0;
+    // Cheap accessors for hot paths (proxying)
+    virtual bool isRunning() const = 0;
+    virtual QString ownerApiKey() const = 0;
+    virtual QString foreignApiKey() const = 0;
+    // Change counters for conditional requests. statusVersion() covers
+    // statusBytes(), logVersion() the log store. Only ever grow within one
+    // process.
+    virtual quint64 statusVersion() const = 0;
+    virtual quint64 logVersion() const = 0;
+    // Resource time series of the node process and log store usage as JSON
+    // object; last <= 0: all samples
+    virtual QByteArray metricsBytes(int last) const = 0;
+
+    // Totals since the controller started, for /metrics
+    struct Counters {
+        quint64 starts = 0;
+        quint64 exits = 0;
+        quint64 linesIngested = 0;
+        quint64 linesDropped = 0;   // evicted from the in-memory buffer
+        quint64 bytesDropped = 0;   // node output not stored, ingest fell behind
+    };
+    virtual Counters counters() const = 0;
     virtual QStringList lastLogLines(int n) const = 0;
+    // Calls visit for each of the last n lines (oldest first) with a view into
+    // the log store; the view is only valid during the call
+    using LineVisitor = std::function<void(QByteArrayView line)>;
+    virtual void visitLastLogLines(int n, const LineVisitor &visit) const = 0;
+    // Lines with seq > afterSeq, oldest first, at most limit. Returns the seq of
+    // the newest stored line; firstSeq receives the oldest one still stored.
+    using SeqLineVisitor = std::function<void(quint64 seq, QByteArrayView line)>;
+    virtual quint64 visitLogSince(quint64 afterSeq, int limit, const SeqLineVisitor &visit,
+                                  quint64 *firstSeq = nullptr) const = 0;
+    // Filter for visitLogFiltered(); empty members match every line
+    struct LogFilter {
+        quint32 levels = 0;     // mask of LogClassifier::levelBit()
+        QByteArray module;      // module name or path prefix, e.g. "grin_chain" or "Chain"
+        std::function<bool(QByteArrayView line)> text;
+    };
+    // A stored line with the fields parsed at ingest; views are valid during
+    // the visitor call only
+    struct LogRecord {
+        quint64 seq = 0;
+        qint64 tsMs = 0;            // written by the node, 0 if the line has none
+        quint8 level = 0;           // LogClassifier::Level
+        QByteArrayView module;
+        QByteArrayView message;
+        QByteArrayView line;        // raw text
+    };
+    using LogRecordVisitor = std::function<void(const LogRecord &rec)>;
+    // Like visitLogSince(), but only lines passing filter. The first skip
+    // matches are counted but not visited; matched receives the number of
+    // matching lines after afterSeq, including those past the limit. Long
+    // scans do not block ingest; lines evicted meanwhile are not counted.
+    virtual quint64 visitLogFiltered(quint64 afterSeq, int skip, int limit, const LogFilter &filter,
+                                     const LogRecordVisitor &visit, quint64 *firstSeq = nullptr,
+                                     int *matched = nullptr) const = 0;
+    // Spooled lines with fromMs <= timestamp <= toMs and seq > afterSeq, at
+    // most limit. Returns false if the node has no spool; more is set if the
+    // limit cut the range.
+    using RecordVisitor = std::function<void(quint64 seq, qint64 tsMs, QByteArrayView line)>;
+    virtual bool visitLogRange(qint64 fromMs, qint64 toMs, quint64 afterSeq, int limit,
+                               const RecordVisitor &visit, bool *more = nullptr) const = 0;
+    // Log store budget in bytes; resizing keeps the newest lines that fit.
+    // Safe from any thread.
+    virtual void setLogCapacity(qint64 capacityBytes) = 0;
+    virtual qint64 logCapacity() const = 0;
     virtual QString dataDir() const = 0;
+
+signals:
+    void logUpdated(QString id);      // log store changed, rate limited
+    void statusChanged(QString id);   // statusBytes() changed, same rate limit
 };
 
 #endif // INODECONTROLLER_H
@@ -0,0 +1,62 @@
+#include "lineframer.h"
+
+#include <QtAlgorithms>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define LINEFRAMER_SSE2
+#endif
+
+/**
+ * @brief LineFramer::reset
+ */
+void LineFramer::reset()
+{
+    m_carry.clear();
+}
+
+/**
+ * @brief LineFramer::findLineEnd
+ * Compares 32 (AVX2) or 16 (SSE2) bytes at a time against '\n' and '\r';
+ * the tail and other targets use a plain loop.
+ * @param p
+ * @param n
+ * @return
+ */
+qsizetype LineFramer::findLineEnd(const char *p, qsizetype n)
+{
+    qsizetype i = 0;
+
+#if defined(__AVX2__)
+    const __m256i lf = _mm256_set1_epi8('\n');
+    const __m256i cr = _mm256_set1_epi8('\r');
+    for (; i + 32 <= n; i += 32) {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + i));
+        const __m256i hit = _mm256_or_si256(_mm256_cmpeq_epi8(v, lf), _mm256_cmpeq_epi8(v, cr));
+        const uint mask = uint(_mm256_movemask_epi8(hit));
+        if (mask) {
+            return i + qCountTrailingZeroBits(mask);
+        }
+    }
+#elif defined(LINEFRAMER_SSE2)
+    const __m128i lf = _mm_set1_epi8('\n');
+    const __m128i cr = _mm_set1_epi8('\r');
+    for (; i + 16 <= n; i += 16) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i));
+        const __m128i hit = _mm_or_si128(_mm_cmpeq_epi8(v, lf), _mm_cmpeq_epi8(v, cr));
+        const uint mask = uint(_mm_movemask_epi8(hit));
+        if (mask) {
+            return i + qCountTrailingZeroBits(mask);
+        }
+    }
+#endif
+
+    for (; i < n; ++i) {
+        if (p[i] == '\n' || p[i] == '\r') {
+            return i;
+        }
+    }
+    return n;
+}
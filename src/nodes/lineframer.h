@@ -0,0 +1,77 @@
+#ifndef LINEFRAMER_H
+#define LINEFRAMER_H
+
+#include <QByteArray>
+#include <QByteArrayView>
+
+/**
+ * @brief The LineFramer class
+ * Cuts a byte stream (one pipe of a node) into lines. "\n", "\r" and "\r\n"
+ * end a line, empty lines are skipped. An unfinished line at the end of a
+ * chunk is carried over to the next one, so lines split across two pipe
+ * reads stay whole. Whole lines inside a chunk are handed out as views into
+ * the chunk, without copying.
+ */
+class LineFramer
+{
+public:
+    // Longer lines are cut into pieces of this size
+    static constexpr qsizetype kMaxLineBytes = 64 * 1024;
+
+    template<typename Sink>
+    void feed(QByteArrayView chunk, Sink &&sink);
+
+    // Emits the carried partial line, e.g. when the process has exited
+    template<typename Sink>
+    void flush(Sink &&sink);
+
+    void reset();
+
+    // Offset of the first '\n' or '\r' in [p, p + n), n if there is none
+    static qsizetype findLineEnd(const char *p, qsizetype n);
+
+private:
+    QByteArray m_carry;
+};
+
+template<typename Sink>
+void LineFramer::feed(QByteArrayView chunk, Sink &&sink)
+{
+    const char *p = chunk.data();
+    qsizetype left = chunk.size();
+
+    while (left > 0) {
+        const qsizetype end = findLineEnd(p, left);
+        if (end == left) {
+            // Unfinished line, wait for the rest
+            m_carry.append(p, left);
+            if (m_carry.size() >= kMaxLineBytes) {
+                sink(QByteArrayView(m_carry));
+                m_carry.truncate(0);
+            }
+            return;
+        }
+
+        if (!m_carry.isEmpty()) {
+            m_carry.append(p, end);
+            sink(QByteArrayView(m_carry));
+            m_carry.truncate(0);
+        } else if (end > 0) {
+            sink(QByteArrayView(p, end));
+        }
+
+        p += end + 1;
+        left -= end + 1;
+    }
+}
+
+template<typename Sink>
+void LineFramer::flush(Sink &&sink)
+{
+    if (!m_carry.isEmpty()) {
+        sink(QByteArrayView(m_carry));
+        m_carry.truncate(0);
+    }
+}
+
+#endif // LINEFRAMER_H
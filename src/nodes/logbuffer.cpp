@@ -0,0 +1,353 @@
+#include "logbuffer.h"
+
+/**
+ * @brief LogBuffer::LogBuffer
+ * @param capacityBytes
+ */
+LogBuffer::LogBuffer(qint64 capacityBytes)
+{
+    setCapacity(capacityBytes);
+}
+
+/**
+ * @brief LogBuffer::setCapacity
+ * Copies the newest lines that fit into a new arena, packed from its
+ * start; the rest count as evicted. Seqs are not affected.
+ * @param capacityBytes
+ */
+void LogBuffer::setCapacity(qint64 capacityBytes)
+{
+    const int cap = int(qBound(kMinCapacity, capacityBytes, kMaxCapacity));
+    if (m_arena.isEmpty()) {
+        allocate(cap, 1024);
+        clear();
+        return;
+    }
+    if (cap == m_arena.size()) {
+        return;
+    }
+
+    const int maxLines = int(cap / kMinLineCost);
+    int keep = 0;
+    qint64 bytes = 0;
+    while (keep < m_count && keep < maxLines) {
+        const int len = entry(m_count - 1 - keep).length;
+        if (bytes + len > cap) {
+            if (keep == 0) {
+                // Newest line alone is too long: cut, like append() does
+                bytes = cap;
+                keep = 1;
+            }
+            break;
+        }
+        bytes += len;
+        ++keep;
+    }
+
+    LogBuffer old(std::move(*this));
+    int indexSize = 1024;
+    while (indexSize < keep) {
+        indexSize *= 2;
+    }
+    allocate(cap, indexSize);
+    m_nextSeq = old.m_nextSeq;
+    m_evicted = old.m_evicted + quint64(old.m_count - keep);
+
+    int pos = 0;
+    for (int i = old.m_count - keep; i < old.m_count; ++i) {
+        const int at = old.slot(i);
+        const int len = qMin(old.m_index[at].length, cap - pos);
+        memcpy(m_arena.data() + pos, old.m_arena.constData() + old.m_index[at].offset, size_t(len));
+        m_index[m_count] = Entry{ pos, len };
+        m_tsMs[m_count] = old.m_tsMs[at];
+        m_level[m_count] = old.m_level[at];
+        m_module[m_count] = old.m_module[at];
+        m_messageOffset[m_count] = quint16(qMin<int>(old.m_messageOffset[at], len));
+        ++m_count;
+        pos += len;
+    }
+    m_used = pos;
+    m_writePos = pos;
+}
+
+/**
+ * @brief LogBuffer::allocate
+ * Fresh arena and rings, no lines.
+ * @param cap
+ * @param indexSize
+ */
+void LogBuffer::allocate(int cap, int indexSize)
+{
+    // Untouched pages of the arena are not resident until lines land there
+    m_arena = QByteArray(cap, Qt::Uninitialized);
+    m_index = QVector<Entry>(indexSize);
+    m_tsMs = QVector<qint64>(indexSize);
+    m_level = QVector<quint8>(indexSize);
+    m_module = QVector<quint16>(indexSize);
+    m_messageOffset = QVector<quint16>(indexSize);
+    m_maxLines = int(cap / kMinLineCost);
+    m_writePos = 0;
+    m_first = 0;
+    m_count = 0;
+    m_used = 0;
+}
+
+/**
+ * @brief LogBuffer::capacity
+ * @return
+ */
+qint64 LogBuffer::capacity() const
+{
+    return m_arena.size();
+}
+
+/**
+ * @brief LogBuffer::usedBytes
+ * @return
+ */
+qint64 LogBuffer::usedBytes() const
+{
+    return m_used;
+}
+
+/**
+ * @brief LogBuffer::lineCount
+ * @return
+ */
+int LogBuffer::lineCount() const
+{
+    return m_count;
+}
+
+/**
+ * @brief LogBuffer::evictedLines
+ * @return
+ */
+quint64 LogBuffer::evictedLines() const
+{
+    return m_evicted;
+}
+
+/**
+ * @brief LogBuffer::parseByteSize
+ * @param text
+ * @param ok
+ * @return
+ */
+qint64 LogBuffer::parseByteSize(const QString &text, bool *ok)
+{
+    QString t = text.trimmed().toUpper();
+    qint64 factor = 1;
+    if (t.endsWith('K')) {
+        factor = 1024;
+    } else if (t.endsWith('M')) {
+        factor = 1024 * 1024;
+    } else if (t.endsWith('G')) {
+        factor = 1024 * 1024 * 1024;
+    }
+    if (factor > 1) {
+        t.chop(1);
+    }
+    const qint64 v = t.toLongLong(ok);
+    return *ok ? v * factor : 0;
+}
+
+/**
+ * @brief LogBuffer::firstSeq
+ * @return
+ */
+quint64 LogBuffer::firstSeq() const
+{
+    return m_nextSeq - quint64(m_count);
+}
+
+/**
+ * @brief LogBuffer::lastSeq
+ * @return
+ */
+quint64 LogBuffer::lastSeq() const
+{
+    return m_nextSeq - 1;
+}
+
+/**
+ * @brief LogBuffer::clear
+ */
+void LogBuffer::clear()
+{
+    m_writePos = 0;
+    m_first = 0;
+    m_count = 0;
+    m_used = 0;
+}
+
+/**
+ * @brief LogBuffer::setNextSeq
+ * Ignored while lines are stored, seqs must not go back.
+ * @param seq
+ */
+void LogBuffer::setNextSeq(quint64 seq)
+{
+    if (m_count == 0 && seq > m_nextSeq) {
+        m_nextSeq = seq;
+    }
+}
+
+/**
+ * @brief LogBuffer::append
+ * Lines longer than the arena are cut.
+ * @param line
+ * @param tag
+ */
+void LogBuffer::append(QByteArrayView line, LineTag tag)
+{
+    const int cap = int(m_arena.size());
+    const int len = int(qMin<qsizetype>(line.size(), cap));
+    if (len == 0) {
+        return;
+    }
+
+    if (m_count >= m_maxLines) {
+        dropOldest();
+    }
+    if (m_count == 0) {
+        m_writePos = 0;
+    }
+
+    if (m_writePos + len > cap) {
+        // No room before the end: the rest of the arena is skipped. Lines
+        // of the previous lap behind the write position go first, they are
+        // older than anything at the start of the arena.
+        while (m_count > 0 && entry(0).offset >= m_writePos) {
+            dropOldest();
+        }
+        m_writePos = 0;
+    }
+
+    // Make room for [m_writePos, m_writePos + len)
+    while (m_count > 0 && entry(0).offset >= m_writePos && entry(0).offset < m_writePos + len) {
+        dropOldest();
+    }
+
+    memcpy(m_arena.data() + m_writePos, line.data(), size_t(len));
+
+    if (m_count == m_index.size()) {
+        growIndex();
+    }
+    const int at = (m_first + m_count) % m_index.size();
+    m_index[at] = Entry{ m_writePos, len };
+    m_tsMs[at] = tag.tsMs;
+    m_level[at] = tag.level;
+    m_module[at] = tag.module;
+    m_messageOffset[at] = quint16(qMin<int>(tag.messageOffset, len));
+    ++m_count;
+    ++m_nextSeq;
+    m_used += len;
+    m_writePos += len;
+}
+
+/**
+ * @brief LogBuffer::line
+ * @param i
+ * @return
+ */
+QByteArrayView LogBuffer::line(int i) const
+{
+    const Entry &e = entry(i);
+    return QByteArrayView(m_arena.constData() + e.offset, e.length);
+}
+
+/**
+ * @brief LogBuffer::tag
+ * @param i
+ * @return
+ */
+LineTag LogBuffer::tag(int i) const
+{
+    const int at = slot(i);
+    LineTag t;
+    t.tsMs = m_tsMs[at];
+    t.level = m_level[at];
+    t.module = m_module[at];
+    t.messageOffset = m_messageOffset[at];
+    return t;
+}
+
+/**
+ * @brief LogBuffer::level
+ * @param i
+ * @return
+ */
+quint8 LogBuffer::level(int i) const
+{
+    return m_level[slot(i)];
+}
+
+/**
+ * @brief LogBuffer::module
+ * @param i
+ * @return
+ */
+quint16 LogBuffer::module(int i) const
+{
+    return m_module[slot(i)];
+}
+
+/**
+ * @brief LogBuffer::slot
+ * @param i
+ * @return position of line i in the rings
+ */
+int LogBuffer::slot(int i) const
+{
+    return (m_first + i) % m_index.size();
+}
+
+/**
+ * @brief LogBuffer::entry
+ * @param i
+ * @return
+ */
+const LogBuffer::Entry &LogBuffer::entry(int i) const
+{
+    return m_index[slot(i)];
+}
+
+/**
+ * @brief LogBuffer::dropOldest
+ */
+void LogBuffer::dropOldest()
+{
+    ++m_evicted;
+    m_used -= entry(0).length;
+    m_first = (m_first + 1) % m_index.size();
+    --m_count;
+}
+
+/**
+ * @brief LogBuffer::growIndex
+ * Unrolls the index ring and the columns into buffers of twice the size.
+ */
+void LogBuffer::growIndex()
+{
+    const int size = m_index.size() * 2;
+    QVector<Entry> index(size);
+    QVector<qint64> tsMs(size);
+    QVector<quint8> level(size);
+    QVector<quint16> module(size);
+    QVector<quint16> messageOffset(size);
+    for (int i = 0; i < m_count; ++i) {
+        const int at = slot(i);
+        index[i] = m_index[at];
+        tsMs[i] = m_tsMs[at];
+        level[i] = m_level[at];
+        module[i] = m_module[at];
+        messageOffset[i] = m_messageOffset[at];
+    }
+    m_index.swap(index);
+    m_tsMs.swap(tsMs);
+    m_level.swap(level);
+    m_module.swap(module);
+    m_messageOffset.swap(messageOffset);
+    m_first = 0;
+}
@@ -0,0 +1,89 @@
+#ifndef LOGBUFFER_H
+#define LOGBUFFER_H
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QString>
+#include <QVector>
+
+// Per-line fields parsed at ingest, filterable without touching the text
+struct LineTag {
+    qint64 tsMs = 0;            // timestamp written by the node, 0 if none
+    quint8 level = 0;           // LogClassifier::Level
+    quint16 module = 0;         // id in the owner's module table, 0 = none
+    quint16 messageOffset = 0;  // start of the message text in the line
+};
+
+/**
+ * @brief The LogBuffer class
+ * Ring buffer of log lines in one contiguous UTF-8 byte arena plus a
+ * compact (offset, length) index that wraps with it. Every line is stored
+ * in one piece, so line() is a view into the arena; the oldest lines are
+ * dropped when the arena is full, or when the line count reaches
+ * capacity / kMinLineCost, which bounds the index for floods of tiny
+ * lines. Every line gets a sequence number
+ * (1, 2, ...) that keeps counting across capacity changes.
+ * The parsed fields of each line (LineTag) live in columns parallel to
+ * the index ring, so a scan over one field touches only that column.
+ * Not thread-safe, the owner locks.
+ */
+class LogBuffer
+{
+public:
+    explicit LogBuffer(qint64 capacityBytes);
+
+    void setCapacity(qint64 capacityBytes); // keeps the newest lines that fit
+    qint64 capacity() const;
+    qint64 usedBytes() const;               // bytes of the stored lines
+    int lineCount() const;
+    quint64 evictedLines() const;           // dropped for room since construction
+    quint64 firstSeq() const;               // seq of line(0)
+    quint64 lastSeq() const;                // seq of the newest line, 0 if none yet
+
+    void append(QByteArrayView line, LineTag tag = LineTag());
+    void clear();
+    void setNextSeq(quint64 seq);           // only if empty, e.g. to continue a spool
+
+    // 0 = oldest; valid until the next append()
+    QByteArrayView line(int i) const;
+    LineTag tag(int i) const;
+    quint8 level(int i) const;
+    quint16 module(int i) const;
+
+    static constexpr qint64 kMinCapacity = 64 * 1024;
+    static constexpr qint64 kMaxCapacity = 1024 * 1024 * 1024;
+    // Capacity share per line for the line limit (index + columns ~21 bytes)
+    static constexpr qint64 kMinLineCost = 32;
+
+    // "16777216", "512K", "16M", "1G"
+    static qint64 parseByteSize(const QString &text, bool *ok);
+
+private:
+    struct Entry {
+        int offset;
+        int length;
+    };
+
+    int slot(int i) const;
+    void allocate(int cap, int indexSize);
+    const Entry &entry(int i) const;
+    void dropOldest();
+    void growIndex();
+
+    QByteArray m_arena;
+    int m_writePos = 0;
+    QVector<Entry> m_index;     // ring, m_first = oldest
+    // Columns of LineTag, same ring layout as m_index
+    QVector<qint64> m_tsMs;
+    QVector<quint8> m_level;
+    QVector<quint16> m_module;
+    QVector<quint16> m_messageOffset;
+    int m_first = 0;
+    int m_count = 0;
+    int m_maxLines = 0;
+    qint64 m_used = 0;
+    quint64 m_evicted = 0;
+    quint64 m_nextSeq = 1;
+};
+
+#endif // LOGBUFFER_H
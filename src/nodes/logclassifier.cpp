@@ -0,0 +1,126 @@
+#include "logclassifier.h"
+
+// Level token must start within this prefix
+static const qsizetype kScanBytes = 96;
+static const int kScanTokens = 6;
+
+static bool isSeparator(char ch)
+{
+    return ch == ' ' || ch == '\t' || ch == '[' || ch == ']';
+}
+
+/**
+ * @brief LogClassifier::classify
+ * The token after the level is the module if it is bracketed (Grin++) or
+ * followed by " - " (Grin).
+ * @param line
+ * @param module
+ * @return
+ */
+LogClassifier::Level LogClassifier::classify(QByteArrayView line, QByteArrayView *module)
+{
+    *module = QByteArrayView();
+
+    const char *p = line.data();
+    const qsizetype n = line.size();
+    qsizetype i = 0;
+
+    for (int t = 0; t < kScanTokens && i < qMin(n, kScanBytes); ++t) {
+        while (i < n && isSeparator(p[i])) {
+            ++i;
+        }
+        const qsizetype start = i;
+        while (i < n && !isSeparator(p[i])) {
+            ++i;
+        }
+        if (i == start) {
+            break;
+        }
+
+        Level level;
+        if (!parseLevel(QByteArrayView(p + start, i - start), &level)) {
+            continue;
+        }
+
+        // Module candidate
+        qsizetype m = i;
+        while (m < n && (p[m] == ' ' || p[m] == ']')) {
+            ++m;
+        }
+        const bool bracketed = (m < n && p[m] == '[');
+        if (bracketed) {
+            ++m;
+        }
+        qsizetype e = m;
+        while (e < n && isModuleChar(p[e])) {
+            ++e;
+        }
+        const qsizetype modEnd = (e > m && p[e - 1] == ':') ? e - 1 : e;
+        if (modEnd > m) {
+            const bool closed = bracketed && e < n && p[e] == ']';
+            const bool dashed = !bracketed && QByteArrayView(p + e, n - e).startsWith(" - ");
+            if (closed || dashed) {
+                *module = QByteArrayView(p + m, modEnd - m);
+            }
+        }
+        return level;
+    }
+    return Unknown;
+}
+
+/**
+ * @brief LogClassifier::parseLevel
+ * @param name
+ * @param level
+ * @return
+ */
+bool LogClassifier::parseLevel(QByteArrayView name, Level *level)
+{
+    if (name.size() < 3 || name.size() > 8) {
+        return false;
+    }
+    char buf[8];
+    for (qsizetype i = 0; i < name.size(); ++i) {
+        const char ch = name[i];
+        buf[i] = (ch >= 'A' && ch <= 'Z') ? char(ch + ('a' - 'A')) : ch;
+    }
+    const QByteArrayView lower(buf, name.size());
+
+    if (lower == "error" || lower == "err" || lower == "fatal" || lower == "crit" || lower == "critical") {
+        *level = Error;
+    } else if (lower == "warn" || lower == "warning") {
+        *level = Warn;
+    } else if (lower == "info") {
+        *level = Info;
+    } else if (lower == "debug" || lower == "dbg") {
+        *level = Debug;
+    } else if (lower == "trace") {
+        *level = Trace;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief LogClassifier::levelName
+ * @param level
+ * @return
+ */
+const char *LogClassifier::levelName(Level level)
+{
+    switch (level) {
+    case Error:
+        return "error";
+    case Warn:
+        return "warn";
+    case Info:
+        return "info";
+    case Debug:
+        return "debug";
+    case Trace:
+        return "trace";
+    default:
+        return "unknown";
+    }
+}
@@ -0,0 +1,46 @@
+#ifndef LOGCLASSIFIER_H
+#define LOGCLASSIFIER_H
+
+#include <QByteArrayView>
+
+/**
+ * @brief The LogClassifier class
+ * Finds the level and module of a node log line from its prefix, e.g.
+ *   "20240101 12:00:00.123 WARN grin_servers::common - ..." (Grin)
+ *   "[12:00:00.123] [warning] [Chain] ..."                  (Grin++)
+ * Only the first few tokens are looked at, the message text never.
+ */
+class LogClassifier
+{
+public:
+    enum Level : quint8 {
+        Unknown = 0,
+        Error,
+        Warn,
+        Info,
+        Debug,
+        Trace
+    };
+    static constexpr int kLevelCount = 6;
+
+    // module receives a view into line, empty if there is none
+    static Level classify(QByteArrayView line, QByteArrayView *module);
+
+    // "error", "warn", ... (case-insensitive, common aliases)
+    static bool parseLevel(QByteArrayView name, Level *level);
+    static const char *levelName(Level level);
+
+    static quint32 levelBit(Level level)
+    {
+        return 1u << level;
+    }
+
+    // Characters of a module name or path, e.g. "grin_chain::txhashset"
+    static inline bool isModuleChar(char ch)
+    {
+        return (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || (ch >= '0' && ch <= '9')
+               || ch == '_' || ch == ':' || ch == '.' || ch == '-';
+    }
+};
+
+#endif // LOGCLASSIFIER_H
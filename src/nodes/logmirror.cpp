@@ -0,0 +1,105 @@
+#include "logmirror.h"
+
+#include <QFile>
+
+#include <cstdio>
+
+// Output waiting for our stdout/stderr before node bytes are dropped
+static const qint64 kMaxQueuedBytes = 4 * 1024 * 1024;
+
+/**
+ * @brief LogMirror::instance
+ * @return
+ */
+LogMirror *LogMirror::instance()
+{
+    static LogMirror mirror;
+    return &mirror;
+}
+
+/**
+ * @brief LogMirror::LogMirror
+ */
+LogMirror::LogMirror() :
+    m_thread(QThread::create([this] { run(); }))
+{
+    m_thread->setObjectName(QStringLiteral("log-mirror"));
+    m_thread->start();
+}
+
+/**
+ * @brief LogMirror::~LogMirror
+ * Writes what is still queued, then stops the thread.
+ */
+LogMirror::~LogMirror()
+{
+    {
+        QMutexLocker g(&m_mutex);
+        m_quit = true;
+        m_cond.wakeOne();
+    }
+    m_thread->wait();
+    delete m_thread;
+}
+
+/**
+ * @brief LogMirror::write
+ * @param channel
+ * @param data
+ */
+void LogMirror::write(Channel channel, const QByteArray &data)
+{
+    if (data.isEmpty()) {
+        return;
+    }
+
+    QMutexLocker g(&m_mutex);
+    if (m_queuedBytes + data.size() > kMaxQueuedBytes) {
+        m_droppedBytes += data.size();
+        return;
+    }
+    m_queue.append(Block{ channel, data });
+    m_queuedBytes += data.size();
+    m_cond.wakeOne();
+}
+
+/**
+ * @brief LogMirror::run
+ */
+void LogMirror::run()
+{
+    QFile out;
+    QFile err;
+    out.open(stdout, QIODevice::WriteOnly | QIODevice::Unbuffered);
+    err.open(stderr, QIODevice::WriteOnly | QIODevice::Unbuffered);
+
+    QVector<Block> batch;
+    for (;;) {
+        qint64 dropped = 0;
+        {
+            QMutexLocker g(&m_mutex);
+            while (m_queue.isEmpty() && !m_quit) {
+                m_cond.wait(&m_mutex);
+            }
+            if (m_queue.isEmpty() && m_quit) {
+                break;
+            }
+            // Drops always happened after the queued blocks
+            batch.swap(m_queue);
+            m_queuedBytes = 0;
+            dropped = m_droppedBytes;
+            m_droppedBytes = 0;
+        }
+
+        // Blocking writes happen here only, never on the node's thread
+        for (const Block &b : batch) {
+            (b.channel == Channel::StdErr ? err : out).write(b.data);
+        }
+        batch.clear();
+
+        if (dropped > 0) {
+            err.write(QByteArray("[controller] ") + QByteArray::number(dropped)
+                      + " bytes of node output not mirrored (stdout too slow)\n");
+        }
+    }
+}
@@ -0,0 +1,49 @@
+#ifndef LOGMIRROR_H
+#define LOGMIRROR_H
+
+#include <QByteArray>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QVector>
+#include <QThread>
+
+/**
+ * @brief The LogMirror class
+ * Copies captured node output to the controller's own stdout/stderr on a
+ * background thread. write() never blocks: if our output is slower than
+ * the nodes (e.g. a stalled log driver), bytes beyond the queue budget are
+ * dropped and reported once the queue drains, so the nodes are never
+ * throttled through their pipes.
+ */
+class LogMirror
+{
+public:
+    enum class Channel {
+        StdOut,
+        StdErr
+    };
+
+    static LogMirror *instance();
+
+    void write(Channel channel, const QByteArray &data);
+
+private:
+    struct Block {
+        Channel channel;
+        QByteArray data;
+    };
+
+    LogMirror();
+    ~LogMirror();
+    void run();
+
+    QMutex m_mutex;
+    QWaitCondition m_cond;
+    QVector<Block> m_queue;
+    qint64 m_queuedBytes = 0;
+    qint64 m_droppedBytes = 0;
+    bool m_quit = false;
+    QThread *m_thread;
+};
+
+#endif // LOGMIRROR_H
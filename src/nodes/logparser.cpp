@@ -0,0 +1,186 @@
+#include "logparser.h"
+
+#include <QDate>
+#include <QDateTime>
+#include <QTime>
+
+/**
+ * @brief LogParser::parse
+ * Generic: level and module only, no timestamp.
+ * @param line
+ * @param f
+ * @return
+ */
+bool LogParser::parse(QByteArrayView line, LogFields *f)
+{
+    QByteArrayView module;
+    const LogClassifier::Level level = LogClassifier::classify(line, &module);
+    if (level == LogClassifier::Unknown) {
+        return false;
+    }
+    f->level = level;
+    f->module = module;
+    f->messageOffset = 0;
+    return true;
+}
+
+/**
+ * @brief LogParser::readNumber
+ * @param p
+ * @param digits
+ * @param value
+ * @return
+ */
+bool LogParser::readNumber(const char *p, int digits, int *value)
+{
+    int v = 0;
+    for (int i = 0; i < digits; ++i) {
+        if (p[i] < '0' || p[i] > '9') {
+            return false;
+        }
+        v = v * 10 + (p[i] - '0');
+    }
+    *value = v;
+    return true;
+}
+
+/**
+ * @brief LogParser::localMs
+ * The start of the local hour is cached, not of the day: on a DST change
+ * the UTC offset differs between the hours of one day.
+ * @return epoch ms, 0 for an invalid date
+ */
+qint64 LogParser::localMs(int year, int month, int day, int hour, int minute, int second, int ms)
+{
+    const qint64 key = (qint64(year) * 10000 + month * 100 + day) * 100 + hour;
+    if (key != m_cachedHour) {
+        const QDate date(year, month, day);
+        const QTime time(hour, 0);
+        if (!date.isValid() || !time.isValid()) {
+            return 0;
+        }
+        m_cachedHourMs = QDateTime(date, time).toMSecsSinceEpoch();
+        m_cachedHour = key;
+    }
+    return m_cachedHourMs + (qint64(minute) * 60 + second) * 1000 + ms;
+}
+
+/**
+ * @brief GrinRustLogParser::parse
+ * log4rs pattern "{d(%Y%m%d %H:%M:%S%.3f)} {l} {M} - {m}"
+ * @param line
+ * @param f
+ * @return
+ */
+bool GrinRustLogParser::parse(QByteArrayView line, LogFields *f)
+{
+    const char *p = line.data();
+    const qsizetype n = line.size();
+    int y, mo, d, h, mi, s, ms;
+    if (n < 24 || p[8] != ' ' || p[11] != ':' || p[14] != ':' || p[17] != '.' || p[21] != ' '
+        || !readNumber(p, 4, &y) || !readNumber(p + 4, 2, &mo) || !readNumber(p + 6, 2, &d)
+        || !readNumber(p + 9, 2, &h) || !readNumber(p + 12, 2, &mi) || !readNumber(p + 15, 2, &s)
+        || !readNumber(p + 18, 3, &ms)) {
+        return LogParser::parse(line, f);
+    }
+
+    qsizetype i = 22;
+    while (i < n && p[i] == ' ') {
+        ++i;
+    }
+    const qsizetype levelStart = i;
+    while (i < n && p[i] != ' ') {
+        ++i;
+    }
+    LogClassifier::Level level;
+    if (!LogClassifier::parseLevel(QByteArrayView(p + levelStart, i - levelStart), &level)) {
+        return LogParser::parse(line, f);
+    }
+    while (i < n && p[i] == ' ') {
+        ++i;
+    }
+
+    f->tsMs = localMs(y, mo, d, h, mi, s, ms);
+    f->level = level;
+    f->module = QByteArrayView();
+    f->messageOffset = i;
+
+    const qsizetype moduleStart = i;
+    while (i < n && LogClassifier::isModuleChar(p[i])) {
+        ++i;
+    }
+    if (i > moduleStart && QByteArrayView(p + i, n - i).startsWith(" - ")) {
+        f->module = QByteArrayView(p + moduleStart, i - moduleStart);
+        f->messageOffset = i + 3;
+    }
+    return true;
+}
+
+/**
+ * @brief GrinPPLogParser::parse
+ * spdlog pattern "[%Y-%m-%d %H:%M:%S.%e] [%l] ..."
+ * @param line
+ * @param f
+ * @return
+ */
+bool GrinPPLogParser::parse(QByteArrayView line, LogFields *f)
+{
+    const char *p = line.data();
+    const qsizetype n = line.size();
+    int y, mo, d, h, mi, s, ms;
+    if (n < 28 || p[0] != '[' || p[5] != '-' || p[8] != '-' || (p[11] != ' ' && p[11] != 'T')
+        || p[14] != ':' || p[17] != ':' || p[20] != '.' || p[24] != ']'
+        || !readNumber(p + 1, 4, &y) || !readNumber(p + 6, 2, &mo) || !readNumber(p + 9, 2, &d)
+        || !readNumber(p + 12, 2, &h) || !readNumber(p + 15, 2, &mi) || !readNumber(p + 18, 2, &s)
+        || !readNumber(p + 21, 3, &ms)) {
+        return LogParser::parse(line, f);
+    }
+
+    qsizetype i = 25;
+    while (i < n && p[i] == ' ') {
+        ++i;
+    }
+    if (i >= n || p[i] != '[') {
+        return LogParser::parse(line, f);
+    }
+    const qsizetype levelStart = ++i;
+    while (i < n && p[i] != ']') {
+        ++i;
+    }
+    LogClassifier::Level level;
+    if (i >= n || !LogClassifier::parseLevel(QByteArrayView(p + levelStart, i - levelStart), &level)) {
+        return LogParser::parse(line, f);
+    }
+    ++i;
+    while (i < n && p[i] == ' ') {
+        ++i;
+    }
+
+    f->tsMs = localMs(y, mo, d, h, mi, s, ms);
+    f->level = level;
+    f->module = QByteArrayView();
+    f->messageOffset = i;
+
+    if (i < n && p[i] == '[') {
+        const qsizetype moduleStart = i + 1;
+        qsizetype e = moduleStart;
+        while (e < n && LogClassifier::isModuleChar(p[e])) {
+            ++e;
+        }
+        if (e > moduleStart && e < n && p[e] == ']') {
+            f->module = QByteArrayView(p + moduleStart, e - moduleStart);
+            f->messageOffset = (e + 1 < n && p[e + 1] == ' ') ? e + 2 : e + 1;
+        }
+    } else {
+        const qsizetype moduleStart = i;
+        qsizetype e = i;
+        while (e < n && LogClassifier::isModuleChar(p[e])) {
+            ++e;
+        }
+        if (e > moduleStart && QByteArrayView(p + e, n - e).startsWith(" - ")) {
+            f->module = QByteArrayView(p + moduleStart, e - moduleStart);
+            f->messageOffset = e + 3;
+        }
+    }
+    return true;
+}
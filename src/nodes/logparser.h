@@ -0,0 +1,61 @@
+#ifndef LOGPARSER_H
+#define LOGPARSER_H
+
+#include <QByteArrayView>
+
+#include "logclassifier.h"
+
+// Fields of one log line, views point into the line
+struct LogFields {
+    qint64 tsMs = 0;        // timestamp written by the node, 0 if none
+    LogClassifier::Level level = LogClassifier::Unknown;
+    QByteArrayView module;
+    qsizetype messageOffset = 0;
+};
+
+/**
+ * @brief The LogParser class
+ * Splits a node's log line into typed fields once, at ingest. The base
+ * class only finds level and module (LogClassifier); the node classes
+ * install a parser for their own format. Used by the node thread only.
+ */
+class LogParser
+{
+public:
+    virtual ~LogParser() = default;
+
+    // false if the line has no recognisable prefix (continuation line)
+    virtual bool parse(QByteArrayView line, LogFields *f);
+
+protected:
+    // Node timestamps are local time; the start of the hour is cached
+    qint64 localMs(int year, int month, int day, int hour, int minute, int second, int ms);
+    static bool readNumber(const char *p, int digits, int *value);
+
+private:
+    qint64 m_cachedHour = -1;    // yyyymmddhh
+    qint64 m_cachedHourMs = 0;
+};
+
+/**
+ * @brief The GrinRustLogParser class
+ * "20240115 10:11:12.345 INFO grin_servers::grin::server - message"
+ */
+class GrinRustLogParser : public LogParser
+{
+public:
+    bool parse(QByteArrayView line, LogFields *f) override;
+};
+
+/**
+ * @brief The GrinPPLogParser class
+ * "[2024-01-15 10:11:12.345] [info] [Chain] message" or
+ * "[2024-01-15 10:11:12.345] [warning] Class::method - message"
+ */
+class GrinPPLogParser : public LogParser
+{
+public:
+    bool parse(QByteArrayView line, LogFields *f) override;
+};
+
+#endif // LOGPARSER_H
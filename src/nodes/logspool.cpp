@@ -0,0 +1,511 @@
+#include "logspool.h"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QtEndian>
+#include <QDebug>
+
+#ifdef Q_OS_UNIX
+#include <sys/stat.h>
+#endif
+
+// Record: magic, length, seq, timestamp (little endian), then the line
+static const quint32 kRecordMagic = 0x314C4F47; // "GOL1"
+static const qint64 kRecordHeader = 24;
+// One index point per this many bytes of a segment
+static const qint64 kIndexStride = 64 * 1024;
+static const qint64 kIndexEntrySize = 24;
+
+static const qint64 kMinSegmentBytes = 1024 * 1024;
+static const qint64 kMaxSegmentBytes = 64 * 1024 * 1024;
+
+/**
+ * @brief readRecordHeader
+ * @param p
+ * @param left
+ * @param len
+ * @param seq
+ * @param ts
+ * @return false if no complete, valid record starts at p
+ */
+static bool readRecordHeader(const uchar *p, qint64 left, quint32 *len, quint64 *seq, qint64 *ts)
+{
+    if (left < kRecordHeader || qFromLittleEndian<quint32>(p) != kRecordMagic) {
+        return false;
+    }
+    *len = qFromLittleEndian<quint32>(p + 4);
+    *seq = qFromLittleEndian<quint64>(p + 8);
+    *ts = qFromLittleEndian<qint64>(p + 16);
+    return qint64(*len) <= left - kRecordHeader;
+}
+
+/**
+ * @brief LogSpool::LogSpool
+ * @param dir
+ * @param retentionBytes total size of all segments
+ */
+LogSpool::LogSpool(const QString &dir, qint64 retentionBytes) :
+    m_dir(dir),
+    m_retention(qMax(kMinSegmentBytes * 2, retentionBytes)),
+    m_segmentBytes(qBound(kMinSegmentBytes, m_retention / 8, kMaxSegmentBytes))
+{
+}
+
+/**
+ * @brief LogSpool::~LogSpool
+ */
+LogSpool::~LogSpool()
+{
+    commit();
+    closeSegment();
+}
+
+/**
+ * @brief LogSpool::dir
+ * @return
+ */
+QString LogSpool::dir() const
+{
+    return m_dir;
+}
+
+/**
+ * @brief LogSpool::lastSeq
+ * @return
+ */
+quint64 LogSpool::lastSeq() const
+{
+    QReadLocker g(&m_lock);
+    for (int i = m_segments.size() - 1; i >= 0; --i) {
+        if (m_segments[i].size > 0) {
+            return m_segments[i].lastSeq;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief LogSpool::totalBytes
+ * @return
+ */
+qint64 LogSpool::totalBytes() const
+{
+    QReadLocker g(&m_lock);
+    return m_total;
+}
+
+/**
+ * @brief LogSpool::open
+ * @return
+ */
+bool LogSpool::open()
+{
+    commit();
+    closeSegment();
+
+    QDir d(m_dir);
+    if (!d.exists() && !QDir().mkpath(m_dir)) {
+        qWarning() << "[spool] cannot create" << m_dir;
+        return false;
+    }
+
+    QVector<Segment> segments;
+    const QStringList files = d.entryList({ "*.log" }, QDir::Files, QDir::Name);
+    for (int i = 0; i < files.size(); ++i) {
+        Segment seg;
+        seg.path = d.filePath(QFileInfo(files[i]).completeBaseName());
+        const bool last = (i == files.size() - 1);
+        if (!loadSegment(seg, last) && !last) {
+            QFile::remove(seg.path + ".log");
+            QFile::remove(seg.path + ".idx");
+            continue;
+        }
+        segments.append(seg);
+    }
+
+    {
+        QWriteLocker g(&m_lock);
+        m_segments = segments;
+        m_total = 0;
+        for (const Segment &s : m_segments) {
+            m_total += s.size;
+        }
+    }
+
+    // Continue the newest segment if it has room
+    if (!m_segments.isEmpty() && m_segments.last().size < m_segmentBytes) {
+        const Segment &cur = m_segments.last();
+        m_file.setFileName(cur.path + ".log");
+        m_indexFile.setFileName(cur.path + ".idx");
+        if (m_file.open(QIODevice::Append | QIODevice::Unbuffered)
+            && m_indexFile.open(QIODevice::Append | QIODevice::Unbuffered)) {
+            m_lastIndexed = cur.index.isEmpty() ? -1 : cur.index.last().offset;
+        } else {
+            closeSegment();
+        }
+    }
+
+    enforceRetention();
+    return true;
+}
+
+/**
+ * @brief LogSpool::loadSegment
+ * Reads the side index and walks the records behind its last point to
+ * find the end; without an index the whole segment is scanned and the
+ * index rewritten.
+ * @param seg
+ * @param truncateTail cut a partly written last record
+ * @return false if the segment holds no valid record
+ */
+bool LogSpool::loadSegment(Segment &seg, bool truncateTail)
+{
+    QFile data(seg.path + ".log");
+    if (!data.open(QIODevice::ReadWrite)) {
+        return false;
+    }
+    const qint64 fileSize = data.size();
+
+    QFile idx(seg.path + ".idx");
+    if (idx.open(QIODevice::ReadOnly)) {
+        const QByteArray raw = idx.readAll();
+        const uchar *p = reinterpret_cast<const uchar *>(raw.constData());
+        for (qint64 i = 0; i + kIndexEntrySize <= raw.size(); i += kIndexEntrySize) {
+            IndexEntry e{ qFromLittleEndian<quint64>(p + i), qFromLittleEndian<qint64>(p + i + 8),
+                          qFromLittleEndian<qint64>(p + i + 16) };
+            if (e.offset >= fileSize || (!seg.index.isEmpty() && e.offset <= seg.index.last().offset)) {
+                break;
+            }
+            seg.index.append(e);
+        }
+        idx.close();
+    }
+    const int loaded = seg.index.size();
+
+    qint64 pos = seg.index.isEmpty() ? 0 : seg.index.last().offset;
+    qint64 lastIndexed = seg.index.isEmpty() ? -1 : pos;
+    if (fileSize > pos) {
+        uchar *map = data.map(pos, fileSize - pos);
+        if (!map) {
+            return false;
+        }
+        const qint64 len = fileSize - pos;
+        qint64 off = 0;
+        quint32 recLen;
+        quint64 seq;
+        qint64 ts;
+        while (readRecordHeader(map + off, len - off, &recLen, &seq, &ts)) {
+            if (lastIndexed < 0 || pos + off - lastIndexed >= kIndexStride) {
+                seg.index.append(IndexEntry{ seq, ts, pos + off });
+                lastIndexed = pos + off;
+            }
+            seg.lastSeq = seq;
+            seg.lastTs = ts;
+            off += kRecordHeader + recLen;
+        }
+        data.unmap(map);
+        pos += off;
+    }
+
+    if (pos < fileSize && truncateTail) {
+        data.resize(pos);
+    }
+    data.close();
+
+    if (seg.index.isEmpty()) {
+        return false;
+    }
+    seg.size = pos;
+    seg.firstSeq = seg.index.first().seq;
+    seg.firstTs = seg.index.first().tsMs;
+
+    if (seg.index.size() != loaded) {
+        // Index was missing or behind, write it out again
+        QByteArray raw(int(seg.index.size() * kIndexEntrySize), Qt::Uninitialized);
+        uchar *p = reinterpret_cast<uchar *>(raw.data());
+        for (const IndexEntry &e : seg.index) {
+            qToLittleEndian<quint64>(e.seq, p);
+            qToLittleEndian<qint64>(e.tsMs, p + 8);
+            qToLittleEndian<qint64>(e.offset, p + 16);
+            p += kIndexEntrySize;
+        }
+        if (idx.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            idx.write(raw);
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief LogSpool::startSegment
+ * @param firstSeq
+ * @return
+ */
+bool LogSpool::startSegment(quint64 firstSeq)
+{
+    Segment seg;
+    seg.path = QDir(m_dir).filePath(QString::asprintf("%020llu", static_cast<unsigned long long>(firstSeq)));
+
+    // The directory may have been removed together with the node data,
+    // and with it every listed segment
+    if (!QFileInfo::exists(m_dir)) {
+        {
+            QWriteLocker g(&m_lock);
+            m_segments.clear();
+            m_total = 0;
+        }
+        QDir().mkpath(m_dir);
+    }
+    m_file.setFileName(seg.path + ".log");
+    m_indexFile.setFileName(seg.path + ".idx");
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Unbuffered)
+        || !m_indexFile.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Unbuffered)) {
+        qWarning() << "[spool] cannot create segment" << seg.path;
+        closeSegment();
+        return false;
+    }
+    m_lastIndexed = -1;
+
+    QWriteLocker g(&m_lock);
+    m_segments.append(seg);
+    return true;
+}
+
+/**
+ * @brief LogSpool::segmentUnlinked
+ * @return true if the open segment file was deleted behind our back
+ */
+bool LogSpool::segmentUnlinked() const
+{
+#ifdef Q_OS_UNIX
+    struct stat st;
+    return ::fstat(m_file.handle(), &st) == 0 && st.st_nlink == 0;
+#else
+    // Windows does not delete open files
+    return false;
+#endif
+}
+
+/**
+ * @brief LogSpool::closeSegment
+ */
+void LogSpool::closeSegment()
+{
+    m_file.close();
+    m_indexFile.close();
+}
+
+/**
+ * @brief LogSpool::append
+ * @param seq
+ * @param tsMs
+ * @param line
+ */
+void LogSpool::append(quint64 seq, qint64 tsMs, QByteArrayView line)
+{
+    const qint64 recSize = kRecordHeader + line.size();
+
+    if (m_pending.isEmpty() && m_file.isOpen() && segmentUnlinked()) {
+        // Directory removed (/delete/{id}): the listed segments are gone,
+        // this batch starts a new one instead of an unlinked file
+        closeSegment();
+        m_pendingIndex.clear();
+        QWriteLocker g(&m_lock);
+        m_segments.clear();
+        m_total = 0;
+    }
+    if (m_file.isOpen()) {
+        const qint64 used = m_segments.last().size + m_pending.size();
+        if (used > 0 && used + recSize > m_segmentBytes) {
+            commit();
+            closeSegment();
+        }
+    }
+    if (!m_file.isOpen() && !startSegment(seq)) {
+        return;
+    }
+
+    const qint64 offset = m_segments.last().size + m_pending.size();
+    if (m_lastIndexed < 0 || offset - m_lastIndexed >= kIndexStride) {
+        m_pendingIndex.append(IndexEntry{ seq, tsMs, offset });
+        m_lastIndexed = offset;
+    }
+
+    if (m_pending.isEmpty()) {
+        m_pendingFirstSeq = seq;
+        m_pendingFirstTs = tsMs;
+    }
+    m_pendingLastSeq = seq;
+    m_pendingLastTs = tsMs;
+
+    const qsizetype at = m_pending.size();
+    m_pending.resize(at + recSize);
+    uchar *p = reinterpret_cast<uchar *>(m_pending.data() + at);
+    qToLittleEndian<quint32>(kRecordMagic, p);
+    qToLittleEndian<quint32>(quint32(line.size()), p + 4);
+    qToLittleEndian<quint64>(seq, p + 8);
+    qToLittleEndian<qint64>(tsMs, p + 16);
+    memcpy(p + kRecordHeader, line.data(), size_t(line.size()));
+}
+
+/**
+ * @brief LogSpool::commit
+ * Writes the pending records and index points, then publishes them to
+ * readers.
+ */
+void LogSpool::commit()
+{
+    if (m_pending.isEmpty()) {
+        return;
+    }
+
+    const qint64 n = m_pending.size();
+    if (!m_file.isOpen() || m_file.write(m_pending) != n) {
+        qWarning() << "[spool] write failed:" << m_file.fileName() << m_file.errorString();
+        // The segment ends with a partial record now, start a new one
+        closeSegment();
+        m_pending.clear();
+        m_pendingIndex.clear();
+        return;
+    }
+
+    if (!m_pendingIndex.isEmpty()) {
+        QByteArray raw(int(m_pendingIndex.size() * kIndexEntrySize), Qt::Uninitialized);
+        uchar *p = reinterpret_cast<uchar *>(raw.data());
+        for (const IndexEntry &e : m_pendingIndex) {
+            qToLittleEndian<quint64>(e.seq, p);
+            qToLittleEndian<qint64>(e.tsMs, p + 8);
+            qToLittleEndian<qint64>(e.offset, p + 16);
+            p += kIndexEntrySize;
+        }
+        m_indexFile.write(raw);
+    }
+
+    {
+        QWriteLocker g(&m_lock);
+        Segment &cur = m_segments.last();
+        if (cur.size == 0) {
+            cur.firstSeq = m_pendingFirstSeq;
+            cur.firstTs = m_pendingFirstTs;
+        }
+        cur.size += n;
+        cur.lastSeq = m_pendingLastSeq;
+        cur.lastTs = m_pendingLastTs;
+        cur.index += m_pendingIndex;
+        m_total += n;
+    }
+
+    m_pending.clear();
+    m_pendingIndex.clear();
+
+    if (m_total > m_retention) {
+        enforceRetention();
+    }
+}
+
+/**
+ * @brief LogSpool::enforceRetention
+ * Drops the oldest segments, never the one being written. Readers that
+ * still map a removed file keep their view (POSIX).
+ */
+void LogSpool::enforceRetention()
+{
+    QWriteLocker g(&m_lock);
+    while (m_total > m_retention && m_segments.size() > 1) {
+        const Segment &old = m_segments.first();
+        QFile::remove(old.path + ".log");
+        QFile::remove(old.path + ".idx");
+        m_total -= old.size;
+        m_segments.removeFirst();
+    }
+}
+
+/**
+ * @brief LogSpool::readRange
+ * @param fromMs
+ * @param toMs
+ * @param afterSeq
+ * @param limit
+ * @param visit line is a view into the mapped file, valid during the call
+ * @param more
+ * @return
+ */
+int LogSpool::readRange(qint64 fromMs, qint64 toMs, quint64 afterSeq, int limit,
+                        const RecordVisitor &visit, bool *more) const
+{
+    QVector<Segment> segments;
+    {
+        QReadLocker g(&m_lock);
+        segments = m_segments;  // shared, the index vectors are not copied
+    }
+
+    int visited = 0;
+    bool cut = false;
+    bool done = false;
+
+    for (const Segment &seg : segments) {
+        if (done) {
+            break;
+        }
+        if (seg.size == 0 || seg.lastTs < fromMs || seg.lastSeq <= afterSeq) {
+            continue;
+        }
+        if (seg.firstTs > toMs) {
+            break;
+        }
+
+        // Last index point before the first wanted record
+        int lo = 0;
+        int hi = seg.index.size() - 1;
+        while (lo < hi) {
+            const int mid = (lo + hi + 1) / 2;
+            const IndexEntry &e = seg.index[mid];
+            if (e.tsMs < fromMs || e.seq <= afterSeq) {
+                lo = mid;
+            } else {
+                hi = mid - 1;
+            }
+        }
+        const qint64 start = seg.index.isEmpty() ? 0 : seg.index[lo].offset;
+        const qint64 len = seg.size - start;
+        if (len <= 0) {
+            continue;
+        }
+
+        QFile f(seg.path + ".log");
+        if (!f.open(QIODevice::ReadOnly)) {
+            continue;   // removed by retention meanwhile
+        }
+        uchar *map = f.map(start, len);
+        if (!map) {
+            continue;
+        }
+
+        qint64 off = 0;
+        quint32 recLen;
+        quint64 seq;
+        qint64 ts;
+        while (readRecordHeader(map + off, len - off, &recLen, &seq, &ts)) {
+            if (ts > toMs) {
+                done = true;
+                break;
+            }
+            if (seq > afterSeq && ts >= fromMs) {
+                if (visited >= limit) {
+                    cut = true;
+                    done = true;
+                    break;
+                }
+                visit(seq, ts, QByteArrayView(reinterpret_cast<const char *>(map + off + kRecordHeader), recLen));
+                ++visited;
+            }
+            off += kRecordHeader + recLen;
+        }
+        f.unmap(map);
+    }
+
+    if (more) {
+        *more = cut;
+    }
+    return visited;
+}
@@ -0,0 +1,90 @@
+#ifndef LOGSPOOL_H
+#define LOGSPOOL_H
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QFile>
+#include <QReadWriteLock>
+#include <QString>
+#include <QVector>
+
+#include <functional>
+
+/**
+ * @brief The LogSpool class
+ * Disk history of one node's log lines: append-only segment files of a
+ * fixed maximum size in a directory, oldest segments deleted once the
+ * total exceeds the retention budget. Each segment has a sparse index
+ * (seq, timestamp -> file offset) kept in memory and in a ".idx" side
+ * file. Range reads map only the part of a segment from the nearest index
+ * point on, so history is read from the page cache, not held in RSS.
+ *
+ * append()/commit() are called by the node's thread only; readRange() may
+ * run concurrently on any thread.
+ */
+class LogSpool
+{
+public:
+    using RecordVisitor = std::function<void(quint64 seq, qint64 tsMs, QByteArrayView line)>;
+
+    LogSpool(const QString &dir, qint64 retentionBytes);
+    ~LogSpool();
+
+    bool open();    // (re)scans the directory, creates it if needed
+    QString dir() const;
+    quint64 lastSeq() const;
+    qint64 totalBytes() const;
+
+    // Buffered until commit(), which writes the batch in one go
+    void append(quint64 seq, qint64 tsMs, QByteArrayView line);
+    void commit();
+
+    // Records with fromMs <= ts <= toMs and seq > afterSeq, at most limit.
+    // Returns the number visited; more is set if the limit cut the range.
+    int readRange(qint64 fromMs, qint64 toMs, quint64 afterSeq, int limit,
+                  const RecordVisitor &visit, bool *more = nullptr) const;
+
+private:
+    struct IndexEntry {
+        quint64 seq;
+        qint64 tsMs;
+        qint64 offset;
+    };
+
+    struct Segment {
+        QString path;           // without suffix
+        quint64 firstSeq = 0;
+        quint64 lastSeq = 0;
+        qint64 firstTs = 0;
+        qint64 lastTs = 0;
+        qint64 size = 0;        // committed bytes
+        QVector<IndexEntry> index;
+    };
+
+    bool loadSegment(Segment &seg, bool truncateTail);
+    bool startSegment(quint64 firstSeq);
+    void closeSegment();
+    bool segmentUnlinked() const;
+    void enforceRetention();
+
+    QString m_dir;
+    qint64 m_retention;
+    qint64 m_segmentBytes;
+
+    mutable QReadWriteLock m_lock;  // m_segments
+    QVector<Segment> m_segments;    // oldest first, last one is written
+    qint64 m_total = 0;
+
+    // Writer side
+    QFile m_file;
+    QFile m_indexFile;
+    QByteArray m_pending;
+    QVector<IndexEntry> m_pendingIndex;
+    qint64 m_lastIndexed = -1;      // offset of the newest index point
+    quint64 m_pendingFirstSeq = 0;
+    quint64 m_pendingLastSeq = 0;
+    qint64 m_pendingFirstTs = 0;
+    qint64 m_pendingLastTs = 0;
+};
+
+#endif // LOGSPOOL_H
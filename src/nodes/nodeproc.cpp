@@ -1,71 +1,495 @@
 #include "nodeproc.h"
+#include "logmirror.h"
+#include "jsonwriter.h"
 
-/**
- * @brief sanitizeLine
- * @param ba
- * @return
- */
-static QString sanitizeLine(const QByteArray &ba)
-{
-    QString s = QString::fromLocal8Bit(ba);
-    s.replace("\r\n", "\n");
-    s.replace('\r', '\n');
-    return s;
-}
+#include <QVarLengthArray>
+
+// Pipe reads in flight to the ingest thread before they are held back
+static const int kIngestQueueChunks = 1024;
+// Chunks stored under one write lock at most
+static const int kIngestBatchChunks = 256;
+// Output held back on the node thread while ingest is stalled; beyond
+// that it is dropped and counted, like LogMirror does
+static const qint64 kMaxSpillBytes = 16 * 1024 * 1024;
+// Lines a filtered scan checks under one read lock at most
+static const int kFilterSliceLines = 4096;
 
 /**
  * @brief NodeProc::NodeProc
  * @param id
  * @param program
  * @param defaultArgs
- * @param logCapacityLines
+ * @param logCapacityBytes
  * @param parent
  */
-NodeProc::NodeProc(QString id, QString program, QStringList defaultArgs, int logCapacityLines, QObject *parent) :
-    QObject(parent),
+NodeProc::NodeProc(QString id, QString program, QStringList defaultArgs, qint64 logCapacityBytes, QObject *parent) :
+    INodeController(parent),
     m_id(std::move(id)),
     m_program(std::move(program)),
     m_defaultArgs(std::move(defaultArgs)),
-    m_logCapacity(qMax(100, logCapacityLines)),
-    m_logBuffer(m_logCapacity)
+    m_proc(this),
+    m_log(logCapacityBytes),
+    m_modules(1),
+    m_ingestQueue(kIngestQueueChunks),
+    m_ingestThread(QThread::create([this] { ingestLoop(); })),
+    m_spillTimer(this),
+    m_parser(new LogParser),
+    m_notifyTimer(this),
+    m_secretWatcher(this),
+    m_chain(this),
+    m_procStats(this)
 {
+    for (auto &count : m_levelCounts) {
+        count.store(0, std::memory_order_relaxed);
+    }
+
     QObject::connect(&m_proc, &QProcess::readyReadStandardOutput, this, [this] {
-        appendLog(m_proc.readAllStandardOutput());
+        readOutput(QProcess::StandardOutput);
     });
     QObject::connect(&m_proc, &QProcess::readyReadStandardError, this, [this] {
-        appendLog(m_proc.readAllStandardError());
+        readOutput(QProcess::StandardError);
     });
     QObject::connect(&m_proc, qOverload<int, QProcess::ExitStatus>(&QProcess::finished), this, [this](int code, QProcess::ExitStatus es) {
+        // Last line without newline
+        LogChunk flush;
+        flush.kind = LogChunk::Flush;
+        queueLog(std::move(flush));
+        m_chain.stop();
+        m_procStats.stop();
+        {
+            QWriteLocker g(&m_lock);
+            m_running.store(false, std::memory_order_release);
+            m_exitCode = code;
+            m_exits.fetch_add(1, std::memory_order_relaxed);
+            rebuildStatusLocked();
+        }
         emit stopped(m_id, code, es);
     });
     QObject::connect(&m_proc, &QProcess::started, this, [this] {
-        QWriteLocker g(&m_lock);
-        m_startedAt = QDateTime::currentDateTime();
-        emit started(m_id, m_proc.processId());
+        const qint64 pid = m_proc.processId();
+        {
+            QWriteLocker g(&m_lock);
+            m_startedAt = QDateTime::currentDateTime();
+            m_running.store(true, std::memory_order_release);
+            m_pid = pid;
+            m_starts.fetch_add(1, std::memory_order_relaxed);
+            rebuildStatusLocked();
+        }
+        // The node may just have created its data dir and secrets
+        reloadSecrets();
+        m_chain.start();
+        m_procStats.start(pid, m_unixSetSid);
+        emit started(m_id, pid);
     });
+
+    QObject::connect(&m_secretWatcher, &QFileSystemWatcher::fileChanged, this, [this] {
+        reloadSecrets();
+    });
+    QObject::connect(&m_secretWatcher, &QFileSystemWatcher::directoryChanged, this, [this] {
+        reloadSecrets();
+    });
+
+    m_chain.setApiKeys([this] { return ownerApiKey(); }, [this] { return foreignApiKey(); });
+    QObject::connect(&m_chain, &ChainPoller::updated, this, [this] {
+        // Not part of the snapshot, but a change of the status all the same
+        m_statusVersion.fetch_add(1, std::memory_order_release);
+        m_statusDirty.store(true, std::memory_order_release);
+    });
+
+    m_spillTimer.setSingleShot(true);
+    m_spillTimer.setInterval(10);
+    QObject::connect(&m_spillTimer, &QTimer::timeout, this, [this] {
+        drainSpill();
+    });
+
+    m_notifyTimer.setInterval(kDefaultLogNotifyMs);
+    QObject::connect(&m_notifyTimer, &QTimer::timeout, this, [this] {
+        if (m_logDirty.exchange(false, std::memory_order_acq_rel)) {
+            emit logUpdated(m_id);
+        }
+        if (m_statusDirty.exchange(false, std::memory_order_acq_rel)) {
+            emit statusChanged(m_id);
+        }
+    });
+    m_notifyTimer.start();
+
+    {
+        QWriteLocker g(&m_lock);
+        rebuildStatusLocked();
+    }
+
+    m_ingestThread->setObjectName(QStringLiteral("log-ingest-") + m_id);
+    m_ingestThread->start();
+}
+
+/**
+ * @brief NodeProc::~NodeProc
+ * Stores what is still queued, then stops the ingest thread.
+ */
+NodeProc::~NodeProc()
+{
+    m_proc.disconnect(this);
+    drainSpill();
+    m_ingestQuit.store(true, std::memory_order_release);
+    m_ingestWake.release();
+    m_ingestThread->wait();
+    delete m_ingestThread;
+}
+
+/**
+ * @brief NodeProc::readOutput
+ * Drains a pipe completely on every notification, so the node never blocks
+ * on a full pipe. Framing and storing happen on the ingest thread, the
+ * mirror copy on the mirror thread; nothing here waits for a lock (the
+ * log mode is an atomic, the mirror only takes its queue mutex).
+ * @param channel
+ */
+void NodeProc::readOutput(QProcess::ProcessChannel channel)
+{
+    const QByteArray data = (channel == QProcess::StandardOutput) ? m_proc.readAllStandardOutput()
+                                                                  : m_proc.readAllStandardError();
+    if (data.isEmpty()) {
+        return;
+    }
+
+    if (logMode() == LogMode::Tee) {
+        LogMirror::instance()->write(channel == QProcess::StandardOutput ? LogMirror::Channel::StdOut
+                                                                         : LogMirror::Channel::StdErr, data);
+    }
+
+    LogChunk chunk;
+    chunk.stdErr = (channel == QProcess::StandardError);
+    chunk.tsMs = QDateTime::currentMSecsSinceEpoch();
+    chunk.data = data;
+    queueLog(std::move(chunk));
 }
 
 /**
- * @brief NodeProc::appendLog
+ * @brief NodeProc::queueLog
+ * Hands a chunk to the ingest thread. If the queue is full the chunk waits
+ * in the spill list on this thread, behind any earlier ones; output over
+ * kMaxSpillBytes is dropped. Framer commands are always kept.
  * @param chunk
  */
-void NodeProc::appendLog(const QByteArray &chunk)
+void NodeProc::queueLog(LogChunk &&chunk)
 {
-    QString s = sanitizeLine(chunk);
-    const QStringList lines = s.split('\n', Qt::KeepEmptyParts);
-    QWriteLocker g(&m_lock);
-    for (const QString &line : lines) {
-        if (line.isEmpty()) {
-            continue;
+    drainSpill();
+    if (m_ingestSpill.isEmpty() && m_ingestQueue.push(std::move(chunk))) {
+        m_ingestWake.release();
+        return;
+    }
+    if (chunk.kind == LogChunk::Data) {
+        if (m_ingestSpillBytes + chunk.data.size() > kMaxSpillBytes) {
+            m_bytesDropped.fetch_add(quint64(chunk.data.size()), std::memory_order_relaxed);
+            return;
+        }
+        m_ingestSpillBytes += chunk.data.size();
+    }
+    m_ingestSpill.append(std::move(chunk));
+    if (!m_spillTimer.isActive()) {
+        m_spillTimer.start();
+    }
+}
+
+/**
+ * @brief NodeProc::drainSpill
+ */
+void NodeProc::drainSpill()
+{
+    int pushed = 0;
+    while (pushed < m_ingestSpill.size()) {
+        const qint64 size = m_ingestSpill[pushed].data.size();
+        if (!m_ingestQueue.push(std::move(m_ingestSpill[pushed]))) {
+            break;
+        }
+        m_ingestSpillBytes -= size;
+        ++pushed;
+    }
+    if (pushed > 0) {
+        m_ingestSpill.remove(0, pushed);
+        m_ingestWake.release(pushed);
+    }
+    if (!m_ingestSpill.isEmpty() && !m_spillTimer.isActive()) {
+        m_spillTimer.start();
+    }
+}
+
+/**
+ * @brief NodeProc::ingestLoop
+ * Ingest thread: takes whatever is queued and stores it as one batch.
+ */
+void NodeProc::ingestLoop()
+{
+    QVector<LogChunk> batch;
+    for (;;) {
+        m_ingestWake.acquire();
+        const bool quit = m_ingestQuit.load(std::memory_order_acquire);
+
+        LogChunk chunk;
+        while (batch.size() < kIngestBatchChunks && m_ingestQueue.pop(chunk)) {
+            batch.append(std::move(chunk));
+        }
+        // One permit per popped chunk; a permit may still be on its way
+        if (batch.size() > 1) {
+            m_ingestWake.tryAcquire(qMin(int(batch.size()) - 1, m_ingestWake.available()));
+        }
+
+        if (!batch.isEmpty()) {
+            ingestBatch(batch);
+            batch.clear();
+        }
+        if (quit) {
+            while (m_ingestQueue.pop(chunk)) {
+                batch.append(std::move(chunk));
+            }
+            ingestBatch(batch);
+            break;
+        }
+    }
+}
+
+/**
+ * @brief NodeProc::ingestBatch
+ * Frames and parses the chunks into a staging copy without any lock, then
+ * stores the lines under one short write lock. The spool is written after
+ * the lock is released.
+ * @param batch
+ */
+void NodeProc::ingestBatch(QVector<LogChunk> &batch)
+{
+    m_staging.clear();
+    m_stagedLines.clear();
+    QVector<QByteArray> newModules;
+
+    for (const LogChunk &chunk : batch) {
+        LineFramer &framer = chunk.stdErr ? m_stderrFramer : m_stdoutFramer;
+        LineTag *carry = chunk.stdErr ? &m_stderrTag : &m_stdoutTag;
+        auto stage = [this, &newModules](LineTag *c, qint64 tsMs) {
+            return [this, c, tsMs, &newModules](QByteArrayView line) {
+                m_stagedLines.append(StagedLine{ int(m_staging.size()), int(line.size()),
+                                                 tagLine(line, c, &newModules), tsMs });
+                m_staging.append(line.data(), line.size());
+            };
+        };
+
+        switch (chunk.kind) {
+        case LogChunk::Data:
+            framer.feed(chunk.data, stage(carry, chunk.tsMs));
+            break;
+        case LogChunk::Flush:
+        {
+            const qint64 now = QDateTime::currentMSecsSinceEpoch();
+            m_stdoutFramer.flush(stage(&m_stdoutTag, now));
+            m_stderrFramer.flush(stage(&m_stderrTag, now));
+            break;
         }
-        m_logBuffer[(m_logStart + m_logSize) % m_logCapacity] = line;
-        if (m_logSize < m_logCapacity) {
-            ++m_logSize;
+        case LogChunk::Reset:
+            m_stdoutFramer.reset();
+            m_stderrFramer.reset();
+            m_stdoutTag = LineTag();
+            m_stderrTag = LineTag();
+            break;
+        }
+    }
+    if (m_stagedLines.isEmpty()) {
+        return;
+    }
+
+    quint64 firstSeq;
+    quint64 lastSeq;
+    {
+        QWriteLocker g(&m_logLock);
+        m_modules += newModules;
+        firstSeq = m_log.lastSeq() + 1;
+        for (const StagedLine &l : m_stagedLines) {
+            m_log.append(QByteArrayView(m_staging.constData() + l.offset, l.length), l.tag);
+        }
+        lastSeq = m_log.lastSeq();
+    }
+    m_publishedSeq.store(lastSeq, std::memory_order_release);
+    m_logVersion.fetch_add(1, std::memory_order_release);
+    // Every stored line, including continuation lines without a level
+    m_linesIngested.fetch_add(lastSeq + 1 - firstSeq, std::memory_order_relaxed);
+
+    if (m_spool) {
+        quint64 seq = firstSeq;
+        for (const StagedLine &l : m_stagedLines) {
+            m_spool->append(seq++, l.tsMs, QByteArrayView(m_staging.constData() + l.offset, l.length));
+        }
+        m_spool->commit();
+    }
+
+    m_logDirty.store(true, std::memory_order_release);
+}
+
+/**
+ * @brief NodeProc::tagLine
+ * Parses a line into its fields; lines the parser does not recognise
+ * (stack traces, wrapped output) inherit level, module and timestamp from
+ * the previous line of the same channel. Ingest thread, no lock: modules
+ * seen for the first time are collected in newModules and published with
+ * the batch.
+ * @param line
+ * @param carry
+ * @param newModules
+ * @return
+ */
+LineTag NodeProc::tagLine(QByteArrayView line, LineTag *carry, QVector<QByteArray> *newModules)
+{
+    LogFields f;
+    if (!m_parser->parse(line, &f)) {
+        LineTag tag = *carry;
+        tag.messageOffset = 0;
+        return tag;
+    }
+
+    LineTag tag;
+    tag.tsMs = f.tsMs;
+    tag.level = f.level;
+    tag.messageOffset = quint16(qMin<qsizetype>(f.messageOffset, 0xFFFF));
+    if (!f.module.isEmpty()) {
+        const QByteArray name = f.module.toByteArray();
+        auto it = m_moduleIds.constFind(name);
+        if (it != m_moduleIds.cend()) {
+            tag.module = it.value();
         } else {
-            m_logStart = (m_logStart + 1) % m_logCapacity;
+            // m_modules only grows on this thread, its size is stable here
+            const int id = int(m_modules.size() + newModules->size());
+            if (id < 0xFFFF) {
+                tag.module = quint16(id);
+                newModules->append(name);
+                m_moduleIds.insert(name, tag.module);
+            }
+        }
+    }
+    m_levelCounts[tag.level].fetch_add(1, std::memory_order_relaxed);
+    *carry = tag;
+    return tag;
+}
+
+/**
+ * @brief NodeProc::setLogParser
+ * Only before any output arrives, the ingest thread uses the parser
+ * without a lock.
+ * @param parser
+ */
+void NodeProc::setLogParser(LogParser *parser)
+{
+    m_parser.reset(parser);
+}
+
+/**
+ * @brief NodeProc::setLogNotifyInterval
+ * @param ms
+ */
+void NodeProc::setLogNotifyInterval(int ms)
+{
+    m_notifyTimer.setInterval(qMax(1, ms));
+}
+
+/**
+ * @brief NodeProc::setChainPoll
+ * Before start(); the poller runs while the node does.
+ * @param rpcPort
+ * @param intervalMs
+ */
+void NodeProc::setChainPoll(quint16 rpcPort, int intervalMs)
+{
+    m_chain.setPort(rpcPort);
+    m_chain.setInterval(intervalMs);
+}
+
+/**
+ * @brief NodeProc::setProcSampling
+ * Before start().
+ * @param intervalMs
+ * @param samples length of the history
+ */
+void NodeProc::setProcSampling(int intervalMs, int samples)
+{
+    m_procStats.setInterval(intervalMs);
+    m_procStats.setCapacity(samples);
+}
+
+/**
+ * @brief NodeProc::counters
+ * @return
+ */
+INodeController::Counters NodeProc::counters() const
+{
+    Counters c;
+    c.starts = m_starts.load(std::memory_order_relaxed);
+    c.exits = m_exits.load(std::memory_order_relaxed);
+    c.linesIngested = m_linesIngested.load(std::memory_order_relaxed);
+    c.bytesDropped = m_bytesDropped.load(std::memory_order_relaxed);
+    QReadLocker l(&m_logLock);
+    c.linesDropped = m_log.evictedLines();
+    return c;
+}
+
+/**
+ * @brief NodeProc::metricsBytes
+ * @param last
+ * @return
+ */
+QByteArray NodeProc::metricsBytes(int last) const
+{
+    qint64 pid;
+    {
+        QReadLocker g(&m_lock);
+        pid = isRunning() ? m_pid : 0;
+    }
+
+    QByteArray out("{\"id\":");
+    JsonWriter::appendString(out, m_id.toUtf8());
+    out += ",\"running\":";
+    out += pid ? "true" : "false";
+    out += ",\"pid\":" + QByteArray::number(pid);
+    out += ',';
+    m_procStats.appendJson(out, last);
+    out += ',';
+    appendLogUsage(out);
+    out += '}';
+    return out;
+}
+
+/**
+ * @brief NodeProc::appendLogUsage
+ * "log":{seq, capacityBytes, usedBytes, lines, evicted, levels{...}};
+ * moves with every ingest batch, so it is not part of the status.
+ * @param out
+ */
+void NodeProc::appendLogUsage(QByteArray &out) const
+{
+    qint64 capacity;
+    qint64 used;
+    int lines;
+    quint64 evicted;
+    {
+        QReadLocker l(&m_logLock);
+        capacity = m_log.capacity();
+        used = m_log.usedBytes();
+        lines = m_log.lineCount();
+        evicted = m_log.evictedLines();
+    }
+
+    out += "\"log\":{\"seq\":" + QByteArray::number(m_publishedSeq.load(std::memory_order_acquire));
+    out += ",\"capacityBytes\":" + QByteArray::number(capacity);
+    out += ",\"usedBytes\":" + QByteArray::number(used);
+    out += ",\"lines\":" + QByteArray::number(lines);
+    out += ",\"evicted\":" + QByteArray::number(evicted);
+
+    // Parsed lines per level since the controller started
+    out += ",\"levels\":{";
+    for (int l = LogClassifier::Error; l < LogClassifier::kLevelCount; ++l) {
+        if (l > LogClassifier::Error) {
+            out += ',';
         }
+        out += '"';
+        out += LogClassifier::levelName(LogClassifier::Level(l));
+        out += "\":" + QByteArray::number(m_levelCounts[l].load(std::memory_order_relaxed));
     }
-    emit logUpdated(m_id);
+    out += "}}";
 }
 
 /**
@@ -97,7 +521,14 @@ bool NodeProc::start(const QStringList &extraArgs)
     }
     beforeStart(args);
 
-    m_proc.setProcessChannelMode(QProcess::ForwardedChannels);
+    // Partial lines of the previous run must not prefix the first new one
+    LogChunk reset;
+    reset.kind = LogChunk::Reset;
+    queueLog(std::move(reset));
+
+    // Forward: output bypasses us; otherwise both pipes are read (Capture/Tee)
+    m_proc.setProcessChannelMode(logMode() == LogMode::Forward ? QProcess::ForwardedChannels
+                                                               : QProcess::SeparateChannels);
     m_proc.setReadChannel(QProcess::StandardOutput);
 
 #ifdef Q_OS_WIN
@@ -176,7 +607,8 @@ bool NodeProc::start(const QStringList &extraArgs)
 bool NodeProc::stop(int gracefulMs)
 {
     qDebug() << "stop start...";
-    QWriteLocker g(&m_lock);
+    // No lock while waiting: the waits deliver the node's remaining output
+    // to readOutput()
     if (m_proc.state() == QProcess::NotRunning) {
         return true;
     }
@@ -211,6 +643,7 @@ void NodeProc::setProgram(const QString &path)
 {
     QWriteLocker g(&m_lock);
     m_program = path;
+    rebuildStatusLocked();
 }
 
 QStringList NodeProc::defaultArgs() const
@@ -223,96 +656,450 @@ void NodeProc::setDefaultArgs(const QStringList &args)
 {
     QWriteLocker g(&m_lock);
     m_defaultArgs = args;
+    rebuildStatusLocked();
 }
 
+/**
+ * @brief NodeProc::statusJson
+ * @return
+ */
 QJsonObject NodeProc::statusJson() const
 {
-    QReadLocker g(&m_lock);
-    QJsonObject o;
+    return QJsonDocument::fromJson(statusBytes()).object();
+}
 
-    const bool isRunning = (m_proc.state() != QProcess::NotRunning);
+/**
+ * @brief NodeProc::statusBytes
+ * The snapshot of the settled fields plus the last chain sample. Nothing
+ * here moves with the clock or the log, so statusVersion() covers it;
+ * log usage is reported by metricsBytes().
+ * @return serialized status object
+ */
+QByteArray NodeProc::statusBytes() const
+{
+    QByteArray out;
+    {
+        QReadLocker g(&m_lock);
+        out = m_statusSnapshot;
+    }
 
+    out.reserve(out.size() + 256);
+    out += ',';
+    m_chain.appendJson(out);
+    out += '}';
+    return out;
+}
+
+/**
+ * @brief NodeProc::rebuildStatusLocked
+ * Serializes the fields that only change on events (start/stop, setters,
+ * secret files); the closing brace is left off for statusBytes().
+ * Caller holds the write lock.
+ */
+void NodeProc::rebuildStatusLocked()
+{
+    const bool running = m_running.load(std::memory_order_acquire);
+
+    QJsonObject o;
     o["id"] = m_id;
-    o["running"] = isRunning;
-    o["pid"] = static_cast<qint64>(isRunning ? m_proc.processId() : 0);
-    o["exitCode"] = isRunning ? 0 : m_proc.exitCode();
+    o["running"] = running;
+    o["pid"] = running ? m_pid : 0;
+    o["exitCode"] = running ? 0 : m_exitCode;
     o["program"] = m_program;
     o["args"] = QJsonArray::fromStringList(m_defaultArgs);
+    o["startedAt"] = m_startedAt.isValid() ? QJsonValue(m_startedAt.toUTC().toString(Qt::ISODate)) : QJsonValue();
+    // Grin++ hat keine entsprechenden Dateien → ownerApiKey/foreignApiKey bleiben leer
+    o["ownerApiKey"] = m_ownerApiKey;
+    o["foreignApiKey"] = m_foreignApiKey;
 
-    if (m_startedAt.isValid()) {
-        o["startedAt"] = m_startedAt.toUTC().toString(Qt::ISODate);
-        o["uptimeSec"] = isRunning ? m_startedAt.secsTo(QDateTime::currentDateTime()) : 0;
-    } else {
-        o["startedAt"] = QJsonValue();
-        o["uptimeSec"] = 0;
-    }
-
-    //
-    // 🔑 API-Keys aus dem DataDir laden
-    //
-    QString ownerApiKey;
-    QString foreignApiKey;
-
-    if (!m_dataDir.isEmpty()) {
-        QDir dir(m_dataDir);
-
-        auto readFileIfExists = [](const QString &path) -> QString {
-                                    QFile f(path);
-                                    if (!f.exists()) {
-                                        return QString();
-                                    }
-                                    if (!f.open(QIODevice::ReadOnly | QIODevice::Text)) {
-                                        return QString();
-                                    }
-                                    QByteArray data = f.readAll();
-                                    return QString::fromUtf8(data).trimmed();
-                                };
-
-        auto readFirstExisting = [&](const QStringList &candidates) -> QString {
-                                     for (const QString &name : candidates) {
-                                         const QString fullPath = dir.filePath(name);
-                                         QFileInfo fi(fullPath);
-                                         if (fi.exists() && fi.isFile()) {
-                                             QString val = readFileIfExists(fullPath);
-                                             if (!val.isEmpty()) {
-                                                 return val;
-                                             }
-                                         }
-                                     }
-                                     return QString();
-                                 };
-
-        // Rust-Grin: .api_secret / .foreign_api_secret
-        // Fallback: .secret / .foreignsecret für Custom-Setups
-        ownerApiKey = readFirstExisting({ ".api_secret"});
-        foreignApiKey = readFirstExisting({ ".foreign_api_secret"});
+    m_statusSnapshot = QJsonDocument(o).toJson(QJsonDocument::Compact);
+    m_statusSnapshot.chop(1);
+    m_statusVersion.fetch_add(1, std::memory_order_release);
+    m_statusDirty.store(true, std::memory_order_release);
+}
+
+/**
+ * @brief NodeProc::statusVersion
+ * @return
+ */
+quint64 NodeProc::statusVersion() const
+{
+    return m_statusVersion.load(std::memory_order_acquire);
+}
+
+/**
+ * @brief NodeProc::logVersion
+ * @return
+ */
+quint64 NodeProc::logVersion() const
+{
+    return m_logVersion.load(std::memory_order_acquire);
+}
+
+/**
+ * @brief readSecret
+ * @param dir
+ * @param name
+ * @return trimmed content, empty if missing
+ */
+static QString readSecret(const QDir &dir, const QString &name)
+{
+    QFile f(dir.filePath(name));
+    if (!f.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        return QString();
     }
+    return QString::fromUtf8(f.readAll()).trimmed();
+}
 
-    // Grin++ hat keine entsprechenden Dateien → ownerApiKey/foreignApiKey bleiben leer
-    o["ownerApiKey"] = ownerApiKey;
-    o["foreignApiKey"] = foreignApiKey;
+/**
+ * @brief NodeProc::reloadSecrets
+ * API-Keys aus dem DataDir laden (Rust-Grin: .api_secret /
+ * .foreign_api_secret) and watch them; the directory is watched as well,
+ * so files created later (first node start) are picked up. Node thread.
+ */
+void NodeProc::reloadSecrets()
+{
+    const QString dirPath = dataDir();
+    QString owner;
+    QString foreign;
+
+    if (!m_secretWatcher.files().isEmpty()) {
+        m_secretWatcher.removePaths(m_secretWatcher.files());
+    }
+    if (!m_secretWatcher.directories().isEmpty()) {
+        m_secretWatcher.removePaths(m_secretWatcher.directories());
+    }
 
-    return o;
+    if (!dirPath.isEmpty()) {
+        const QDir dir(dirPath);
+        owner = readSecret(dir, ".api_secret");
+        foreign = readSecret(dir, ".foreign_api_secret");
+
+        if (dir.exists()) {
+            m_secretWatcher.addPath(dirPath);
+        }
+        for (const char *name : { ".api_secret", ".foreign_api_secret" }) {
+            const QString path = dir.filePath(name);
+            if (QFileInfo::exists(path)) {
+                m_secretWatcher.addPath(path);
+            }
+        }
+    }
+
+    QWriteLocker g(&m_lock);
+    if (owner != m_ownerApiKey || foreign != m_foreignApiKey) {
+        m_ownerApiKey = owner;
+        m_foreignApiKey = foreign;
+        rebuildStatusLocked();
+    }
 }
 
-QStringList NodeProc::lastLogLines(int n) const
+/**
+ * @brief NodeProc::isRunning
+ * @return
+ */
+bool NodeProc::isRunning() const
+{
+    return m_running.load(std::memory_order_acquire);
+}
+
+/**
+ * @brief NodeProc::ownerApiKey
+ * @return
+ */
+QString NodeProc::ownerApiKey() const
 {
     QReadLocker g(&m_lock);
-    n = qBound(1, n, m_logSize);
-    QStringList out;
-    out.reserve(n);
-    int start = (m_logStart + (m_logSize - n + m_logCapacity)) % m_logCapacity;
-    for (int i = 0; i < n; ++i) {
-        out << m_logBuffer[(start + i) % m_logCapacity];
+    return m_ownerApiKey;
+}
+
+/**
+ * @brief NodeProc::foreignApiKey
+ * @return
+ */
+QString NodeProc::foreignApiKey() const
+{
+    QReadLocker g(&m_lock);
+    return m_foreignApiKey;
+}
+
+/**
+ * @brief NodeProc::setDataDir
+ * @param dir
+ */
+void NodeProc::setDataDir(const QString &dir)
+{
+    {
+        QWriteLocker g(&m_lock);
+        m_dataDir = dir;
     }
+    reloadSecrets();
+}
+
+/**
+ * @brief NodeProc::dataDir
+ * @return
+ */
+QString NodeProc::dataDir() const
+{
+    QReadLocker g(&m_lock);
+    return m_dataDir;
+}
+
+QStringList NodeProc::lastLogLines(int n) const
+{
+    QStringList out;
+    visitLastLogLines(n, [&out](QByteArrayView line) {
+        out << QString::fromUtf8(line);
+    });
     return out;
 }
 
-void NodeProc::setLogCapacity(int capacityLines)
+/**
+ * @brief NodeProc::visitLastLogLines
+ * Runs under the read lock, the lines are not copied.
+ * @param n
+ * @param visit
+ */
+void NodeProc::visitLastLogLines(int n, const LineVisitor &visit) const
 {
-    QWriteLocker g(&m_lock);
-    m_logCapacity = qMax(100, capacityLines);
-    m_logBuffer = QVector<QString>(m_logCapacity);
-    m_logStart = 0;
-    m_logSize = 0;
+    QReadLocker g(&m_logLock);
+    const int count = m_log.lineCount();
+    n = qBound(0, n, count);
+    for (int i = count - n; i < count; ++i) {
+        visit(m_log.line(i));
+    }
+}
+
+/**
+ * @brief NodeProc::visitLogSince
+ * @param afterSeq
+ * @param limit
+ * @param visit
+ * @param firstSeq
+ * @return
+ */
+quint64 NodeProc::visitLogSince(quint64 afterSeq, int limit, const SeqLineVisitor &visit, quint64 *firstSeq) const
+{
+    QReadLocker g(&m_logLock);
+    const quint64 first = m_log.firstSeq();
+    const quint64 last = m_log.lastSeq();
+    if (firstSeq) {
+        *firstSeq = first;
+    }
+
+    quint64 seq = qMax(afterSeq + 1, first);
+    for (int i = 0; seq <= last && i < limit; ++seq, ++i) {
+        visit(seq, m_log.line(int(seq - first)));
+    }
+    return last;
+}
+
+/**
+ * @brief NodeProc::visitLogFiltered
+ * Level and module are checked against the line tags first, the text
+ * filter only runs on lines that pass them. The store is scanned in slices
+ * of kFilterSliceLines, the read lock is dropped in between so ingest is
+ * not held up by a long grep. Lines evicted meanwhile are skipped.
+ * @param afterSeq
+ * @param skip
+ * @param limit
+ * @param filter
+ * @param visit
+ * @param firstSeq
+ * @param matched
+ * @return
+ */
+quint64 NodeProc::visitLogFiltered(quint64 afterSeq, int skip, int limit, const LogFilter &filter,
+                                   const LogRecordVisitor &visit, quint64 *firstSeq, int *matched) const
+{
+    QReadLocker g(&m_logLock);
+    quint64 first = m_log.firstSeq();
+    // Lines arriving during the scan are left for the next call
+    const quint64 last = m_log.lastSeq();
+    if (firstSeq) {
+        *firstSeq = first;
+    }
+
+    // Module ids accepted by the filter, resolved again when new ones appear
+    QVarLengthArray<bool, 256> moduleOk;
+    auto resolveModules = [&]() {
+        const int from = int(moduleOk.size());
+        moduleOk.resize(qMax<qsizetype>(1, m_modules.size()));
+        moduleOk[0] = false;
+        for (int id = qMax(1, from); id < m_modules.size(); ++id) {
+            const QByteArray &name = m_modules[id];
+            moduleOk[id] = name.compare(filter.module, Qt::CaseInsensitive) == 0
+                           || (name.startsWith(filter.module)
+                               && QByteArrayView(name).sliced(filter.module.size()).startsWith("::"));
+        }
+    };
+    if (!filter.module.isEmpty()) {
+        resolveModules();
+    }
+
+    int count = 0;
+    int visited = 0;
+    int sliceLeft = kFilterSliceLines;
+    for (quint64 seq = qMax(afterSeq + 1, first); seq <= last; ++seq) {
+        if (--sliceLeft < 0) {
+            // Let waiting writers in
+            g.unlock();
+            g.relock();
+            sliceLeft = kFilterSliceLines;
+            first = m_log.firstSeq();
+            if (seq < first) {
+                seq = first;
+                if (firstSeq) {
+                    *firstSeq = first;
+                }
+                if (seq > last) {
+                    break;
+                }
+            }
+            if (!moduleOk.isEmpty() && moduleOk.size() < m_modules.size()) {
+                resolveModules();
+            }
+        }
+
+        const int i = int(seq - first);
+        if (filter.levels && !(filter.levels & LogClassifier::levelBit(LogClassifier::Level(m_log.level(i))))) {
+            continue;
+        }
+        if (!moduleOk.isEmpty() && !moduleOk[m_log.module(i)]) {
+            continue;
+        }
+        const QByteArrayView line = m_log.line(i);
+        if (filter.text && !filter.text(line)) {
+            continue;
+        }
+        if (count++ < skip) {
+            continue;
+        }
+        if (visited < limit) {
+            const LineTag tag = m_log.tag(i);
+            LogRecord rec;
+            rec.seq = seq;
+            rec.tsMs = tag.tsMs;
+            rec.level = tag.level;
+            if (tag.module > 0 && tag.module < m_modules.size()) {
+                rec.module = m_modules[tag.module];
+            }
+            rec.message = line.sliced(tag.messageOffset);
+            rec.line = line;
+            visit(rec);
+            ++visited;
+        } else if (!matched) {
+            break;
+        }
+    }
+    if (matched) {
+        *matched = count;
+    }
+    return last;
+}
+
+/**
+ * @brief NodeProc::visitLogRange
+ * Reads the spool without holding the node lock.
+ * @param fromMs
+ * @param toMs
+ * @param afterSeq
+ * @param limit
+ * @param visit
+ * @param more
+ * @return false if no spool is configured
+ */
+bool NodeProc::visitLogRange(qint64 fromMs, qint64 toMs, quint64 afterSeq, int limit,
+                             const RecordVisitor &visit, bool *more) const
+{
+    if (!m_spool) {
+        return false;
+    }
+    m_spool->readRange(fromMs, toMs, afterSeq, limit, visit, more);
+    return true;
+}
+
+/**
+ * @brief NodeProc::setLogCapacity
+ * Keeps the newest lines that fit; the ingest thread waits meanwhile.
+ * @param capacityBytes
+ */
+void NodeProc::setLogCapacity(qint64 capacityBytes)
+{
+    {
+        QWriteLocker g(&m_logLock);
+        m_log.setCapacity(capacityBytes);
+    }
+    m_logVersion.fetch_add(1, std::memory_order_release);
+    m_logDirty.store(true, std::memory_order_release);
+}
+
+/**
+ * @brief NodeProc::logCapacity
+ * @return
+ */
+qint64 NodeProc::logCapacity() const
+{
+    QReadLocker g(&m_logLock);
+    return m_log.capacity();
+}
+
+/**
+ * @brief NodeProc::setLogSpool
+ * Keeps the log history on disk in <dataDir>/controller-logs. Seqs continue
+ * where the spool ended, so they stay unique across controller restarts.
+ * @param retentionBytes disk budget, 0 disables the spool
+ * @return false if the spool directory cannot be used
+ */
+bool NodeProc::setLogSpool(qint64 retentionBytes)
+{
+    m_spool.reset();
+    const QString base = dataDir();
+    if (retentionBytes <= 0 || base.isEmpty()) {
+        return retentionBytes <= 0;
+    }
+
+    QScopedPointer<LogSpool> spool(new LogSpool(QDir(base).filePath("controller-logs"), retentionBytes));
+    if (!spool->open()) {
+        return false;
+    }
+
+    QWriteLocker g(&m_logLock);
+    m_log.setNextSeq(spool->lastSeq() + 1);
+    m_publishedSeq.store(m_log.lastSeq(), std::memory_order_release);
+    m_logVersion.fetch_add(1, std::memory_order_release);
+    m_spool.swap(spool);
+    return true;
+}
+
+void NodeProc::setLogMode(LogMode mode)
+{
+    m_logMode.store(mode, std::memory_order_relaxed);
+}
+
+NodeProc::LogMode NodeProc::logMode() const
+{
+    return m_logMode.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief NodeProc::parseLogMode
+ * @param name "forward", "capture" or "tee"
+ * @param mode
+ * @return false for an unknown name
+ */
+bool NodeProc::parseLogMode(const QString &name, LogMode *mode)
+{
+    const QString n = name.trimmed().toLower();
+    if (n == "forward") {
+        *mode = LogMode::Forward;
+    } else if (n == "capture") {
+        *mode = LogMode::Capture;
+    } else if (n == "tee") {
+        *mode = LogMode::Tee;
+    } else {
+        return false;
+    }
+    return true;
 }
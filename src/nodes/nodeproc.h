@@ -12,16 +12,45 @@
 #include <QFile>
 #include <QFileInfo>
 #include <QDir>
+#include <QScopedPointer>
+#include <QHash>
+#include <QSemaphore>
+#include <QThread>
+#include <QTimer>
+#include <QFileSystemWatcher>
+#include <QJsonDocument>
 
-#include "inodecontroller.h"
+#include <atomic>
 
-class NodeProc : public QObject, public INodeController
+#include "inodecontroller.h"
+#include "chainpoller.h"
+#include "logbuffer.h"
+#include "logclassifier.h"
+#include "logparser.h"
+#include "lineframer.h"
+#include "logspool.h"
+#include "procsampler.h"
+#include "spscqueue.h"
+
+class NodeProc : public INodeController
 {
     Q_OBJECT
 public:
+    enum class LogMode {
+        Forward,    // child writes to our stdout/stderr directly, nothing is captured
+        Capture,    // both pipes are read into the log buffer
+        Tee         // captured and mirrored to our stdout/stderr
+    };
+
+    static constexpr qint64 kDefaultLogCapacityBytes = 16 * 1024 * 1024;
+    static constexpr int kDefaultLogNotifyMs = 100;
+    static constexpr int kDefaultChainPollMs = 5000;
+    static constexpr int kDefaultProcSampleMs = 5000;
+
     explicit NodeProc(QString id, QString program =
     {
-    }, QStringList defaultArgs = {}, int logCapacityLines = 5000, QObject *parent = nullptr);
+    }, QStringList defaultArgs = {}, qint64 logCapacityBytes = kDefaultLogCapacityBytes, QObject *parent = nullptr);
+    ~NodeProc() override;
 
     // INodeController
     bool start(const QStringList &extraArgs = {}) override;
@@ -36,26 +65,40 @@ public:
     void setDefaultArgs(const QStringList &args) override;
 
     QJsonObject statusJson() const override;
+    QByteArray statusBytes() const override;
+    bool isRunning() const override;
+    QString ownerApiKey() const override;
+    QString foreignApiKey() const override;
+    quint64 statusVersion() const override;
+    quint64 logVersion() const override;
+    QByteArray metricsBytes(int last) const override;
+    Counters counters() const override;
     QStringList lastLogLines(int n) const override;
-
-    void setLogCapacity(int capacityLines);
-
-    void setDataDir(const QString &dir)
-    {
-        QWriteLocker g(&m_lock);
-        m_dataDir = dir;
-    }
-
-    QString dataDir() const override
-    {
-        QReadLocker g(&m_lock);
-        return m_dataDir;
-    }
+    void visitLastLogLines(int n, const LineVisitor &visit) const override;
+    quint64 visitLogSince(quint64 afterSeq, int limit, const SeqLineVisitor &visit,
+                          quint64 *firstSeq = nullptr) const override;
+    quint64 visitLogFiltered(quint64 afterSeq, int skip, int limit, const LogFilter &filter,
+                             const LogRecordVisitor &visit, quint64 *firstSeq = nullptr,
+                             int *matched = nullptr) const override;
+    bool visitLogRange(qint64 fromMs, qint64 toMs, quint64 afterSeq, int limit,
+                       const RecordVisitor &visit, bool *more = nullptr) const override;
+
+    void setLogCapacity(qint64 capacityBytes) override;
+    qint64 logCapacity() const override;
+    bool setLogSpool(qint64 retentionBytes);    // after setDataDir, before start; 0 = off
+    void setLogNotifyInterval(int ms);          // max. rate of logUpdated()
+    void setChainPoll(quint16 rpcPort, int intervalMs);   // 0 = off
+    void setProcSampling(int intervalMs, int samples);    // 0 = off
+    void setLogMode(LogMode mode); // takes effect on the next start
+    LogMode logMode() const;
+    static bool parseLogMode(const QString &name, LogMode *mode);
+
+    void setDataDir(const QString &dir);
+    QString dataDir() const override;
 
 signals:
     void started(QString id, qint64 pid);
     void stopped(QString id, int exitCode, QProcess::ExitStatus es);
-    void logUpdated(QString id);
 
 protected:
     virtual void beforeStart(QStringList &args)
@@ -78,24 +121,102 @@ protected:
         return m_unixSetSid;
     }
 
+    // Parser for the node's log format, takes ownership; set in the ctor
+    void setLogParser(LogParser *parser);
+
 private:
-    void appendLog(const QByteArray &chunk);
+    // One pipe read, or a framer command, on its way to the ingest thread
+    struct LogChunk {
+        enum Kind : quint8 {
+            Data,
+            Flush,  // emit the partial lines (process exited)
+            Reset   // drop the partial lines (process starts)
+        };
+        Kind kind = Data;
+        bool stdErr = false;
+        qint64 tsMs = 0;
+        QByteArray data;
+    };
+
+    // Line framed and parsed outside the store lock, text in m_staging
+    struct StagedLine {
+        int offset;
+        int length;
+        LineTag tag;
+        qint64 tsMs;
+    };
+
+    void readOutput(QProcess::ProcessChannel channel);
+    void queueLog(LogChunk &&chunk);
+    void drainSpill();
+    void ingestLoop();
+    void ingestBatch(QVector<LogChunk> &batch);
+    LineTag tagLine(QByteArrayView line, LineTag *carry, QVector<QByteArray> *newModules);
+    void rebuildStatusLocked();
+    void appendLogUsage(QByteArray &out) const;
+    void reloadSecrets();
 
     QString m_id;
     QString m_program;
     QStringList m_defaultArgs;
     QString m_dataDir;
 
-    mutable QReadWriteLock m_lock;
-    QProcess m_proc;
+    mutable QReadWriteLock m_lock;  // process state and settings, never held for log work
+    QProcess m_proc;                // child, moves along with moveToThread()
     QDateTime m_startedAt;
-
-    // Ringpuffer
-    int m_logCapacity;
-    QVector<QString> m_logBuffer;
-    int m_logStart = 0;
-    int m_logSize = 0;
-
+    std::atomic<bool> m_running{ false };   // set by the started/finished handlers
+    qint64 m_pid = 0;
+    int m_exitCode = 0;
+    std::atomic<quint64> m_starts{ 0 };
+    std::atomic<quint64> m_exits{ 0 };
+
+    // Cached from the data dir, reloaded on start and on watcher events
+    QString m_ownerApiKey;
+    QString m_foreignApiKey;
+    QByteArray m_statusSnapshot;    // serialized settled fields, no closing brace
+    std::atomic<quint64> m_statusVersion{ 0 };  // bumped with every rebuild
+    std::atomic<bool> m_statusDirty{ false };
+
+    // Ringpuffer (UTF-8 arena). Written by the ingest thread in short
+    // sections under m_logLock; readers only ever take the read lock.
+    mutable QReadWriteLock m_logLock;
+    LogBuffer m_log;
+    QVector<QByteArray> m_modules;          // LineTag::module -> name, [0] = none
+    std::atomic<quint64> m_publishedSeq{ 0 };   // newest stored seq, readable without a lock
+    std::atomic<quint64> m_logVersion{ 0 };     // bumped with every change of the log store
+    std::atomic<quint64> m_levelCounts[LogClassifier::kLevelCount];  // parsed lines per level
+    std::atomic<quint64> m_linesIngested{ 0 };  // all stored lines
+
+    // Node thread -> ingest thread
+    SpscQueue<LogChunk> m_ingestQueue;
+    QSemaphore m_ingestWake;
+    std::atomic<bool> m_ingestQuit{ false };
+    QThread *m_ingestThread;
+    QVector<LogChunk> m_ingestSpill;    // node thread only, while the queue is full
+    qint64 m_ingestSpillBytes = 0;
+    std::atomic<quint64> m_bytesDropped{ 0 };  // output not stored, spill budget exceeded
+    QTimer m_spillTimer;
+
+    // Ingest thread only
+    LineFramer m_stdoutFramer;
+    LineFramer m_stderrFramer;
+    LineTag m_stdoutTag;        // of the last parsed line, for continuation lines
+    LineTag m_stderrTag;
+    QHash<QByteArray, quint16> m_moduleIds;
+    QScopedPointer<LogParser> m_parser;
+    QByteArray m_staging;
+    QVector<StagedLine> m_stagedLines;
+    QScopedPointer<LogSpool> m_spool;   // set up before start, written here
+
+    // logUpdated() at most once per interval
+    std::atomic<bool> m_logDirty{ false };
+    QTimer m_notifyTimer;
+
+    QFileSystemWatcher m_secretWatcher;  // node thread only
+    ChainPoller m_chain;                 // while running
+    ProcSampler m_procStats;             // while running, history kept after stop
+
+    std::atomic<LogMode> m_logMode{ LogMode::Tee };    // read on every pipe read
     bool m_unixSetSid = false;
 };
 
@@ -0,0 +1,289 @@
+#include "procsampler.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+
+#ifdef Q_OS_LINUX
+#include <unistd.h>
+#endif
+
+/**
+ * @brief readProcFile
+ * /proc files report size 0, so they are read until EOF.
+ * @param path
+ * @return empty if missing or not readable
+ */
+static QByteArray readProcFile(const QString &path)
+{
+    QFile f(path);
+    if (!f.open(QIODevice::ReadOnly)) {
+        return QByteArray();
+    }
+    return f.readAll();
+}
+
+/**
+ * @brief fieldValue
+ * Number after "key" in "key:  1234 kB" / "key: 1234" lines.
+ * @param text
+ * @param key including the colon
+ * @return 0 if missing
+ */
+static qint64 fieldValue(const QByteArray &text, QByteArrayView key)
+{
+    qsizetype pos = 0;
+    while (pos < text.size()) {
+        qsizetype end = text.indexOf('\n', pos);
+        if (end < 0) {
+            end = text.size();
+        }
+        const QByteArrayView line(text.constData() + pos, end - pos);
+        if (line.startsWith(key)) {
+            const QByteArray value = line.sliced(key.size()).toByteArray().trimmed();
+            const qsizetype space = value.indexOf(' ');
+            return (space < 0 ? value : value.left(space)).toLongLong();
+        }
+        pos = end + 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief ProcSampler::ProcSampler
+ * @param parent
+ */
+ProcSampler::ProcSampler(QObject *parent) :
+    QObject(parent),
+    m_timer(this),
+    m_ring(kDefaultCapacity)
+{
+    connect(&m_timer, &QTimer::timeout, this, &ProcSampler::sample);
+}
+
+/**
+ * @brief ProcSampler::setInterval
+ * @param ms
+ */
+void ProcSampler::setInterval(int ms)
+{
+    m_intervalMs = qMax(0, ms);
+    if (m_intervalMs == 0) {
+        m_timer.stop();
+        return;
+    }
+    m_timer.setInterval(m_intervalMs);
+}
+
+/**
+ * @brief ProcSampler::interval
+ * @return
+ */
+int ProcSampler::interval() const
+{
+    return m_intervalMs;
+}
+
+/**
+ * @brief ProcSampler::setCapacity
+ * @param samples
+ */
+void ProcSampler::setCapacity(int samples)
+{
+    QMutexLocker g(&m_mutex);
+    m_ring = QVector<Sample>(qMax(2, samples));
+    m_head = 0;
+    m_count = 0;
+}
+
+/**
+ * @brief ProcSampler::isSupported
+ * @return
+ */
+bool ProcSampler::isSupported()
+{
+#ifdef Q_OS_LINUX
+    return true;
+#else
+    return false;
+#endif
+}
+
+/**
+ * @brief ProcSampler::start
+ * @param pid
+ * @param wholeGroup pid leads its own process group (started via setsid)
+ */
+void ProcSampler::start(qint64 pid, bool wholeGroup)
+{
+    m_pid = pid;
+    m_wholeGroup = wholeGroup;
+    m_prev = Totals();
+    m_prevMs = 0;
+    {
+        QMutexLocker g(&m_mutex);
+        m_head = 0;
+        m_count = 0;
+        m_peakRssBytes = 0;
+    }
+
+    if (m_intervalMs <= 0 || pid <= 0 || !isSupported()) {
+        return;
+    }
+    // Baseline right away, the first rates follow one interval later
+    sample();
+    m_timer.start();
+}
+
+/**
+ * @brief ProcSampler::stop
+ */
+void ProcSampler::stop()
+{
+    m_timer.stop();
+    m_pid = 0;
+}
+
+/**
+ * @brief ProcSampler::readProcess
+ * @param pid
+ * @param groupId only count pid if it belongs to this process group, 0 = any
+ * @param totals
+ * @return false if pid is gone or not part of the group
+ */
+bool ProcSampler::readProcess(qint64 pid, qint64 groupId, Totals *totals)
+{
+    const QString base = QStringLiteral("/proc/%1/").arg(pid);
+
+    // "pid (comm) state ppid pgrp ..."; comm may contain spaces and parentheses
+    const QByteArray stat = readProcFile(base + QStringLiteral("stat"));
+    const qsizetype close = stat.lastIndexOf(')');
+    if (close < 0) {
+        return false;
+    }
+    const QList<QByteArray> f = stat.mid(close + 2).split(' ');
+    if (f.size() < 18) {
+        return false;
+    }
+    if (groupId > 0 && f[2].toLongLong() != groupId) {
+        return false;
+    }
+
+    // Fields 14/15 (utime, stime) and 20 (num_threads), counted from 1
+    totals->cpuTicks += f[11].toULongLong() + f[12].toULongLong();
+    totals->threads += f[17].toInt();
+    totals->rssBytes += fieldValue(readProcFile(base + QStringLiteral("status")), "VmRSS:") * 1024;
+
+    // Storage I/O; not readable for processes of other users
+    const QByteArray io = readProcFile(base + QStringLiteral("io"));
+    totals->readBytes += fieldValue(io, "read_bytes:");
+    totals->writeBytes += fieldValue(io, "write_bytes:");
+
+    totals->fds += int(QDir(base + QStringLiteral("fd"))
+                       .entryList(QDir::AllEntries | QDir::System | QDir::NoDotAndDotDot, QDir::Unsorted)
+                       .size());
+    ++totals->processes;
+    return true;
+}
+
+/**
+ * @brief ProcSampler::sample
+ */
+void ProcSampler::sample()
+{
+#ifdef Q_OS_LINUX
+    if (m_pid <= 0) {
+        return;
+    }
+
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    Totals t;
+    if (m_wholeGroup) {
+        // Helpers the node spawned share its group
+        const QStringList entries = QDir(QStringLiteral("/proc")).entryList(QDir::Dirs | QDir::NoDotAndDotDot,
+                                                                             QDir::Unsorted);
+        for (const QString &e : entries) {
+            bool ok = false;
+            const qint64 pid = e.toLongLong(&ok);
+            if (ok) {
+                readProcess(pid, m_pid, &t);
+            }
+        }
+    } else {
+        readProcess(m_pid, 0, &t);
+    }
+    if (t.processes == 0) {
+        return;
+    }
+
+    if (m_prevMs == 0 || now <= m_prevMs) {
+        m_prev = t;
+        m_prevMs = now;
+        return;
+    }
+
+    static const double ticksPerSec = double(qMax(1L, sysconf(_SC_CLK_TCK)));
+    const double dt = double(now - m_prevMs) / 1000.0;
+
+    // Exited group members take their counters with them; no negative rates
+    auto delta = [](auto cur, auto prev) {
+        return cur > prev ? double(cur - prev) : 0.0;
+    };
+
+    Sample s;
+    s.tsMs = now;
+    s.cpuPercent = delta(t.cpuTicks, m_prev.cpuTicks) / ticksPerSec / dt * 100.0;
+    s.rssBytes = t.rssBytes;
+    s.readBps = delta(t.readBytes, m_prev.readBytes) / dt;
+    s.writeBps = delta(t.writeBytes, m_prev.writeBytes) / dt;
+    s.fds = t.fds;
+    s.threads = t.threads;
+    s.processes = t.processes;
+
+    m_prev = t;
+    m_prevMs = now;
+
+    QMutexLocker g(&m_mutex);
+    m_ring[m_head] = s;
+    m_head = (m_head + 1) % m_ring.size();
+    m_count = qMin(m_count + 1, int(m_ring.size()));
+    m_peakRssBytes = qMax(m_peakRssBytes, s.rssBytes);
+#endif
+}
+
+/**
+ * @brief ProcSampler::appendJson
+ * @param out
+ * @param last
+ */
+void ProcSampler::appendJson(QByteArray &out, int last) const
+{
+    QMutexLocker g(&m_mutex);
+
+    const int n = (last > 0) ? qMin(last, m_count) : m_count;
+    out += "\"supported\":";
+    out += isSupported() ? "true" : "false";
+    out += ",\"intervalMs\":" + QByteArray::number(m_intervalMs);
+    out += ",\"capacity\":" + QByteArray::number(m_ring.size());
+    out += ",\"peakRssBytes\":" + QByteArray::number(m_peakRssBytes);
+    out += ",\"samples\":[";
+    out.reserve(out.size() + n * 160);
+
+    // Oldest first
+    const int size = int(m_ring.size());
+    for (int i = 0; i < n; ++i) {
+        const Sample &s = m_ring[(m_head - n + i + size) % size];
+        if (i > 0) {
+            out += ',';
+        }
+        out += "{\"ts\":" + QByteArray::number(s.tsMs);
+        out += ",\"cpuPct\":" + QByteArray::number(s.cpuPercent, 'f', 2);
+        out += ",\"rssBytes\":" + QByteArray::number(s.rssBytes);
+        out += ",\"readBps\":" + QByteArray::number(s.readBps, 'f', 0);
+        out += ",\"writeBps\":" + QByteArray::number(s.writeBps, 'f', 0);
+        out += ",\"fds\":" + QByteArray::number(s.fds);
+        out += ",\"threads\":" + QByteArray::number(s.threads);
+        out += ",\"procs\":" + QByteArray::number(s.processes) + '}';
+    }
+    out += ']';
+}
@@ -0,0 +1,81 @@
+#ifndef PROCSAMPLER_H
+#define PROCSAMPLER_H
+
+#include <QObject>
+#include <QTimer>
+#include <QMutex>
+#include <QVector>
+#include <QByteArray>
+
+/**
+ * @brief The ProcSampler class
+ * Resource usage of a node process from /proc (Linux only): CPU time and
+ * thread count from stat, RSS from status, disk I/O from io and the
+ * number of open fds, summed over the process group when the node runs
+ * in its own session (setsid). Samples are turned into rates against the
+ * previous one and kept in a fixed-size ring. Lives on the node's thread;
+ * appendJson() may be called from any thread.
+ */
+class ProcSampler : public QObject
+{
+    Q_OBJECT
+public:
+    static constexpr int kDefaultCapacity = 720;    // 1 h at 5 s
+
+    explicit ProcSampler(QObject *parent = nullptr);
+
+    void setInterval(int ms);       // 0 = off
+    int interval() const;
+    void setCapacity(int samples);  // drops the history
+
+    void start(qint64 pid, bool wholeGroup);   // node started; clears the history
+    void stop();                                // node stopped; history is kept
+
+    static bool isSupported();
+
+    // "intervalMs", "samples" [...] etc. without the enclosing braces;
+    // last <= 0: every sample in the ring
+    void appendJson(QByteArray &out, int last) const;
+
+private:
+    // Cumulative counters as read from /proc
+    struct Totals {
+        quint64 cpuTicks = 0;       // utime + stime
+        qint64 rssBytes = 0;
+        qint64 readBytes = 0;
+        qint64 writeBytes = 0;
+        int fds = 0;
+        int threads = 0;
+        int processes = 0;
+    };
+
+    struct Sample {
+        qint64 tsMs = 0;
+        double cpuPercent = 0;      // of one core
+        qint64 rssBytes = 0;
+        double readBps = 0;
+        double writeBps = 0;
+        int fds = 0;
+        int threads = 0;
+        int processes = 0;
+    };
+
+    void sample();
+    static bool readProcess(qint64 pid, qint64 groupId, Totals *totals);
+
+    QTimer m_timer;
+    int m_intervalMs = 0;
+    qint64 m_pid = 0;
+    bool m_wholeGroup = false;
+    Totals m_prev;
+    qint64 m_prevMs = 0;
+
+    // Read by the HTTP workers
+    mutable QMutex m_mutex;
+    QVector<Sample> m_ring;
+    int m_head = 0;     // next slot to write
+    int m_count = 0;
+    qint64 m_peakRssBytes = 0;
+};
+
+#endif // PROCSAMPLER_H
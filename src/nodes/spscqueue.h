@@ -0,0 +1,71 @@
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+
+#include <QtGlobal>
+
+#include <atomic>
+#include <memory>
+#include <utility>
+
+/**
+ * @brief The SpscQueue class
+ * Bounded lock-free queue for exactly one producer thread and one consumer
+ * thread. Head and tail are only ever advanced by their own side, so push
+ * and pop are a load, a move and a release store. The capacity is rounded
+ * up to a power of two.
+ */
+template<typename T>
+class SpscQueue
+{
+public:
+    explicit SpscQueue(int capacity);
+
+    // Producer side; false if the queue is full
+    bool push(T &&item);
+    // Consumer side; false if the queue is empty
+    bool pop(T &item);
+
+private:
+    std::unique_ptr<T[]> m_slots;
+    quint64 m_mask;
+    alignas(64) std::atomic<quint64> m_head{ 0 };  // next slot to pop
+    alignas(64) std::atomic<quint64> m_tail{ 0 };  // next slot to push
+};
+
+template<typename T>
+SpscQueue<T>::SpscQueue(int capacity)
+{
+    quint64 size = 2;
+    while (size < quint64(capacity)) {
+        size *= 2;
+    }
+    m_slots.reset(new T[size]);
+    m_mask = size - 1;
+}
+
+template<typename T>
+bool SpscQueue<T>::push(T &&item)
+{
+    const quint64 tail = m_tail.load(std::memory_order_relaxed);
+    if (tail - m_head.load(std::memory_order_acquire) > m_mask) {
+        return false;
+    }
+    m_slots[tail & m_mask] = std::move(item);
+    m_tail.store(tail + 1, std::memory_order_release);
+    return true;
+}
+
+template<typename T>
+bool SpscQueue<T>::pop(T &item)
+{
+    const quint64 head = m_head.load(std::memory_order_relaxed);
+    if (head == m_tail.load(std::memory_order_acquire)) {
+        return false;
+    }
+    item = std::move(m_slots[head & m_mask]);
+    m_slots[head & m_mask] = T();   // release the payload now, not on the next lap
+    m_head.store(head + 1, std::memory_order_release);
+    return true;
+}
+
+#endif // SPSCQUEUE_H